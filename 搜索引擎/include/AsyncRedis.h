@@ -0,0 +1,74 @@
+#pragma once
+#include "MutexLock.h"
+#include "Condition.h"
+#include "Thread.h"
+
+#include <sw/redis++/redis++.h>
+#include <functional>
+#include <string>
+#include <vector>
+using std::function;
+using std::string;
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  异步 redis 访问类
+ *
+ *  1. 由一个专门的 redis 线程访问 redis，工作线程只把请求放入队列
+ *  2. redis 线程每次取出队列中的全部请求，用一个 pipeline 一起发出：
+ *     多个工作线程同时发出的 GET 共用一次网络往返
+ *  3. get 与 setex 都放入队列即返回，工作线程不等待网络往返：
+ *     get 带一个回调（continuation），所在批次返回后由 redis 线程调用，
+ *     回调中不应做耗时的计算（应转交线程池）
+ *  4. redis 出错时本批次的 GET 均按未命中处理（只是缓存，不影响正确性）
+ *  5. 已停止时 get 返回 false 且不调用回调，由调用方按未命中处理
+ *
+ *************************************************************/
+class AsyncRedis
+{
+public:
+    using GetCallBack = function<void(const sw::redis::OptionalString &)>;
+
+public:
+    explicit AsyncRedis(const string &);
+    ~AsyncRedis();
+
+    void start();
+    void stop();
+
+    bool get(const string &, GetCallBack &&);
+    void setex(const string &, long long, const string &);
+
+private:
+    struct GetRequest
+    {
+        string key;
+        GetCallBack cb; // 结果返回后在 redis 线程中调用
+        sw::redis::OptionalString result;
+    };
+
+    struct SetRequest
+    {
+        string key;
+        long long ttl;
+        string value;
+    };
+
+    void loop();
+    void execute(vector<GetRequest> &, vector<SetRequest> &);
+
+private:
+    static const size_t MAX_PENDING_SETS = 10000; // 积压的写请求上限（超过则丢弃，只是缓存）
+
+    sw::redis::Redis _redis;
+    vector<GetRequest> _gets; // 待发出的 GET
+    vector<SetRequest> _sets; // 待发出的 SETEX
+    MutexLock _mutex;
+    Condition _pending; // redis 线程等待新请求
+    bool _isExiting;
+    Thread _thread;
+};
+}; // namespace wdcpp
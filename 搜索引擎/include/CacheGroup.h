@@ -1,12 +1,33 @@
 #pragma once
 #include "LRUCache.h"
+#include "SpscQueue.h"
+
+#include <atomic>
 
 namespace wdcpp
 {
 class CacheManager;
+
+/**
+ *  一条新缓存的记录（工作线程写入日志，由定时线程合并后发给各工作线程）
+ */
+struct CacheRecord
+{
+    string key;
+    LRUCache::Value value;
+    uint32_t cost; // 计算该结果所用的时间（微秒）
+    size_t origin; // 产生该记录的工作线程编号
+};
+
 /*************************************************************
  *
- *  cache group 类（包含两块 cache）
+ *  cache group 类（每个工作线程一个）
+ *
+ *  1. _mainCache 只由所属的工作线程访问
+ *  2. 新插入的记录同时写入 _log（单生产者单消费者无锁队列），由定时线程取走合并；
+ *     日志满时记录计入 _dropped，定时线程发现后置位 _copyRequested，
+ *     本线程在下一个安全点提交整个 cache 的副本，代替丢失的记录参与同步
+ *  3. _appliedEpoch 为本线程已应用的合并增量的版本号（只由本线程读写）
  *
  *************************************************************/
 class CacheGroup
@@ -14,17 +35,17 @@ class CacheGroup
     friend class CacheManager;
 
 public:
-    CacheGroup(size_t);
+    CacheGroup(size_t, size_t, size_t, const CacheOptions &);
 
-    string getRecord(const string &);
-    void insertRecord(const string &, const string &);
-    void load(const string &);
-    void dump(const string &);
-    void update(const CacheGroup &);
+    LRUCache::Value getRecord(const string &); // 未命中时返回空指针
+    void insertRecord(const string &, const LRUCache::Value &, uint32_t = 0); // 第三个参数为计算开销（微秒）
 
 private:
-    LRUCache _mainCache;          // 主 cache
-    LRUCache _pendingUpdateCache; // 更新 cache（存放自上次更新以来新的记录，用于更新操作）
-    bool _onlyRead;               // 只读标志（若只读则新记录不能插入到两 cache 中）
+    LRUCache _mainCache;         // 主 cache
+    SpscQueue<CacheRecord> _log; // 自上次同步以来新的记录（工作线程写，定时线程读）
+    size_t _id;                  // 所属工作线程的编号
+    uint64_t _appliedEpoch;
+    std::atomic<size_t> _dropped;      // 日志满而未写入的记录数（工作线程累加，定时线程取走）
+    std::atomic<bool> _copyRequested; // 定时线程要求本线程提交全量副本
 };
 }; // namespace wdcpp
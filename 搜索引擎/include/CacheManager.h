@@ -1,7 +1,16 @@
 #pragma once
 #include "CacheGroup.h"
+#include "MutexLock.h"
+#include "Thread.h"
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
+using std::deque;
+using std::pair;
+using std::shared_ptr;
+using std::unique_ptr;
 using std::vector;
 
 namespace wdcpp
@@ -10,26 +19,114 @@ namespace wdcpp
  *
  *  cache group 管理类（单例类）
  *
+ *  两种缓存模式（配置项 cachemode）：
+ *  1. group（默认）：每个工作线程一个 cache group，按版本号（epoch）增量同步：
+ *     - 工作线程把新记录写入各自的无锁日志，不与定时线程共享 cache
+ *     - 定时线程（sync）取走所有日志，合并去重后作为新版本的增量发布
+ *     - 工作线程在下次访问缓存时（安全点）应用尚未应用的增量（跳过自己产生的记录）
+ *     每次同步的开销只与新记录数成正比；以下两种情况退回全量复制（计数并输出到日志）：
+ *     - 工作线程落后超过 SYNC_HISTORY 个版本（更早的增量已丢弃）：
+ *       从定时线程维护的汇总 cache（_mergedCache）复制全部记录
+ *     - 工作线程的日志满（synclognum）而丢失了记录：该线程在安全点提交自己整个
+ *       cache 的副本，随下一次同步发布
+ *  2. shared：所有工作线程共享一个按键的 hash 值分片的 LRU cache（配置项 cacheshards，
+ *     默认 16），每个分片一把锁；新结果对所有线程立即可见，热门结果只存一份，
+ *     总容量为 recordnum，无需同步
+ *
+ *  两种模式下 cache 的淘汰策略均由配置项 cachepolicy 选择：lru（默认）或 tinylfu
+ *
+ *  容量：每块 cache 最多 recordnum 条记录；配置项 cachebytes 不为 0 时另按字节预算限制，
+ *  预算为总预算：group 模式下各线程的 cache 与 _mergedCache 各存一份，平分给这
+ *  workernum + 1 块 cache；shared 模式平分给各分片；
+ *  配置项 compressbytes 不为 0 时，不短于该长度的结果压缩存放（需以 USE_LZ4 编译，见 LRUCache）
+ *
+ *  缓存快照（配置项 cachesnapshot 为快照文件路径，为空则不使用）：
+ *  1. 每同步 snapshotperiod 次（默认 0，即只在退出时）以及退出时写快照，
+ *     先写临时文件再改名，快照带有索引的版本号
+ *  2. 启动时由加载线程异步读入，服务同时正常处理请求；版本号与当前索引不同的快照作废
+ *  3. group 模式下读入的记录作为一个增量发布给所有工作线程；快照取自 _mergedCache
+ *  4. 文件格式（BinaryWriter 编码，小端）：
+ *       u32 magic "WDSS"  u32 version  u64 generation  u64 count
+ *       count 条记录：string key  string value  u32 cost（按从旧到新的顺序）
+ *
  *************************************************************/
+enum class CacheMode
+{
+    Group,
+    Shared
+};
+
 class CacheManager
 {
+    static const size_t SYNC_HISTORY = 16; // 保留最近的增量个数（落后更多的工作线程放弃更早的增量）
+
 public:
     static CacheManager *getInstance();
 
     CacheGroup &getCacheGroup(size_t);
 
+    LRUCache::Value getRecord(const string &); // 按缓存模式查询当前工作线程可见的 cache
+    void insertRecord(const string &, const LRUCache::Value &, uint32_t = 0); // 第三个参数为计算开销（微秒）
+    CacheMode getMode() const;
+
     void sync();
 
+    uint64_t getDroppedRecords() const; // 因日志满而丢失的记录数（group 模式）
+    uint64_t getFullCopies() const;     // 退回全量复制的次数（group 模式）
+
+    void loadSnapshot(uint64_t); // 参数为当前索引的版本号
+    void dumpSnapshot();
+
 private:
     CacheManager();
-    ~CacheManager() {}
+    ~CacheManager() { joinLoader(); }
 
     static void destroy();
 
+    static CacheMode parseMode();
+    static CachePolicy parsePolicy();
+
+    void applyDeltas(CacheGroup &);
+    void copyMerged(CacheGroup &);
+    void submitCopy(CacheGroup &);
+    void mergeLogs();
+    void publish(vector<CacheRecord> &&);
+    void collectRecords(vector<CacheRecord> &);
+    void doLoadSnapshot();
+    void joinLoader();
+
 private:
+    struct CacheShard
+    {
+        CacheShard(size_t capacity, const CacheOptions &options)
+            : cache(capacity, options)
+        {
+        }
+
+        LRUCache cache;
+        MutexLock mutex;
+    };
+
+    CacheMode _mode;
+    CacheOptions _options; // 每块 cache 的淘汰策略、字节预算与压缩阈值
     size_t _cacheNums;          // cache group 总数（即工作线程总数）
     size_t _maxRecord;          // 一块 LRU cache 的最大记录数
-    vector<CacheGroup> _caches; // 所有线程的 cache group
+    vector<unique_ptr<CacheGroup>> _caches; // 所有线程的 cache group（group 模式）
+    deque<pair<uint64_t, shared_ptr<const vector<CacheRecord>>>> _deltas; // 最近发布的增量 <版本号, 记录>
+    MutexLock _deltaMutex;                  // 保护 _deltas
+    std::atomic<uint64_t> _epoch;           // 最新发布的版本号
+    string _snapshotPath;                   // 快照文件路径（为空则不使用快照）
+    size_t _snapshotPeriod;                 // 每同步多少次写一次快照（0 表示只在退出时写）
+    size_t _syncCount;
+    uint64_t _generation;                   // 当前索引的版本号
+    unique_ptr<LRUCache> _mergedCache;      // 汇总各线程新记录的 cache（group 模式，用于全量复制与写快照）
+    MutexLock _mergedMutex;                 // 保护 _mergedCache
+    vector<CacheRecord> _copies;            // 工作线程提交的全量副本，等待下一次同步发布
+    MutexLock _copyMutex;                   // 保护 _copies
+    std::atomic<uint64_t> _droppedRecords;
+    std::atomic<uint64_t> _fullCopies;
+    unique_ptr<Thread> _loader;             // 快照加载线程
+    vector<unique_ptr<CacheShard>> _shards; // 共享 cache 的分片（shared 模式）
     static CacheManager *_pInstance;
 };
 }; // namespace wdcpp
@@ -49,7 +49,7 @@ class CompareSimhash
 public:
     CompareSimhash()
         : _simhasher(DICT_PATH, MODEL_PATH, IDF_PATH, STOP_WORDS_PATH) {}
-    bool cut(const WebPage &);
+    bool cut(const WebPage &, uint64_t &, uint64_t &);
 
 private:
     vector<hashkey> keylist;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  前缀补全 trie（双数组）
+ *
+ *  1. 离线部分（DictProducer）以词典中的词（按 UTF-8 字节）建 trie，每个结点
+ *     预先记录以该结点为前缀、词频最高的至多 topK 个词的编号
+ *  2. 状态 s 经字节 c 转移到 t = base[s] + c + 1，当且仅当 check[t] == s；
+ *     根结点为 0，空闲单元的 check 为 -1
+ *  3. 查询只需沿前缀走 O(前缀长度) 步，取出该结点的补全列表，不再打分
+ *  4. 文件格式（本机字节序，可直接 mmap）：
+ *       CompletionHeader
+ *       CompletionUnit units[unitCount]
+ *       uint32_t tops[topCount]      每个结点的补全列表（按词频降序）
+ *
+ *************************************************************/
+const uint32_t COMPLETION_MAGIC = 0x43534457; // "WDSC"
+const uint32_t COMPLETION_VERSION = 1;
+
+struct CompletionHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t unitCount;
+    uint32_t topK;     // 每个结点最多记录的补全数
+    uint64_t topCount; // tops 数组的长度
+};
+
+struct CompletionUnit
+{
+    int32_t base;
+    int32_t check;     // 父结点（-1 表示空闲）
+    uint32_t topBegin; // 该结点的补全列表在 tops 中的起始下标
+    uint32_t topCount; // 补全个数
+};
+
+/*************************************************************
+ *
+ *  前缀补全类（在线部分，只读）
+ *
+ *  1. 整个文件通过 mmap 映射，启动时不解析、不分配内存
+ *  2. 文件可选，未配置或损坏时 available() 为 false
+ *
+ *************************************************************/
+class CompletionTrie
+{
+public:
+    CompletionTrie();
+    ~CompletionTrie();
+
+    bool load(const string &);
+    bool available() const;
+
+    bool complete(string_view, vector<uint32_t> &) const;
+
+private:
+    const char *_data; // 文件的映射地址
+    size_t _size;
+    const CompletionHeader *_header;
+    const CompletionUnit *_units;
+    const uint32_t *_tops;
+};
+}; // namespace wdcpp
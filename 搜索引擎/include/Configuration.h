@@ -19,6 +19,21 @@ public:
     static Configuration *getInstance();
     unordered_map<string, string> &getConfigMap();
 
+    /**
+     *  读取配置项 key，若配置文件中没有该项则返回默认值
+     */
+    string get(const string &key, const string &defaultValue) const
+    {
+        auto it = _configMap.find(key);
+        return it == _configMap.end() ? defaultValue : it->second;
+    }
+
+    size_t getNumber(const string &key, size_t defaultValue) const
+    {
+        auto it = _configMap.find(key);
+        return it == _configMap.end() ? defaultValue : std::stoul(it->second);
+    }
+
 private:
     Configuration(const string &);
     ~Configuration(){};
@@ -0,0 +1,75 @@
+#pragma once
+#include "MutexLock.h"
+
+#include <time.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+using std::list;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace wdcpp
+{
+using PageID = long;
+
+/**
+ *  一次查询排好序的结果（游标指向的内容）
+ */
+struct RankedList
+{
+    unordered_map<string, int> wordsMap; // 查询语句分词后的 <word, freq>（翻页时生成摘要用）
+    vector<PageID> IDs;                  // 按相似度排好序的候选文章编号
+    bool partial = false;                // 是否因超时只检索了部分文章
+};
+
+/*************************************************************
+ *
+ *  游标缓存类（分页查询）
+ *
+ *  1. 首次查询时将排好序的文章编号存入，返回一个游标
+ *  2. 翻页时凭游标取回排好序的文章编号，只需为当前页生成摘要并序列化
+ *  3. 游标在 ttl 秒内未被访问则过期；超出容量时淘汰最久未访问的游标
+ *  4. 由多个工作线程共享，内部加锁
+ *
+ *************************************************************/
+class CursorCache
+{
+public:
+    using Cursor = uint64_t;
+    using RankedListPtr = shared_ptr<const RankedList>;
+
+private:
+    struct Entry
+    {
+        Cursor cursor;
+        RankedListPtr rankedList;
+        time_t expireTime;
+    };
+    using iterator = list<Entry>::iterator;
+
+public:
+    CursorCache(size_t, int);
+
+    Cursor put(const RankedListPtr &);
+    RankedListPtr get(Cursor);
+
+private:
+    void expire(time_t);
+
+private:
+    list<Entry> _entryList; // 头部为最近访问的游标
+    unordered_map<Cursor, iterator> _hashMap;
+    size_t _capacity;
+    int _ttl;
+    Cursor _nextCursor;
+    MutexLock _mutex;
+};
+}; // namespace wdcpp
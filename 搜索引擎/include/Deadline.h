@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  查询截止时间类
+ *
+ *  1. 从请求到达时刻起计时（包括在任务队列中等待的时间）
+ *  2. budget 为 0 表示不限时
+ *  3. 只读，检索循环每处理一块数据检查一次 expired
+ *
+ *************************************************************/
+class Deadline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Deadline()
+        : _unlimited(true)
+    {
+    }
+
+    Deadline(Clock::time_point start, size_t budgetMs)
+        : _unlimited(budgetMs == 0),
+          _expireTime(start + std::chrono::milliseconds(budgetMs))
+    {
+    }
+
+    static Clock::time_point now()
+    {
+        return Clock::now();
+    }
+
+    bool expired() const
+    {
+        return !_unlimited && Clock::now() >= _expireTime;
+    }
+
+private:
+    bool _unlimited;
+    Clock::time_point _expireTime;
+};
+}; // namespace wdcpp
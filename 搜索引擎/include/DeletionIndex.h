@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+using std::string;
+using std::u32string;
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  删除变体索引（SymSpell）
+ *
+ *  1. 离线部分（DictProducer）为词典中每个词生成删除至多 maxDist 个字符
+ *     （按码点）得到的所有变体，记录 <变体的哈希, 词编号>
+ *  2. 查询时对关键词同样生成删除变体，逐个查表即得到所有编辑距离
+ *     不超过 maxDist 的候选词（两词编辑距离不超过 k 时，各删除至多 k 个字符
+ *     可得到同一个串）；哈希冲突只会多出候选词，由编辑距离校验剔除
+ *  3. 文件格式（本机字节序，可直接 mmap）：
+ *       DeletionHeader
+ *       DeletionSlot[1 << slotBits]   开放寻址哈希表（线性探测），hash 为 0 表示空槽
+ *       uint32_t ids[idCount]         每个槽位对应一段升序的词编号
+ *
+ *************************************************************/
+const uint32_t DELETION_MAGIC = 0x44534457; // "WDSD"
+const uint32_t DELETION_VERSION = 1;
+
+struct DeletionHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxDist;  // 生成变体时最多删除的字符数
+    uint32_t slotBits; // 槽位数为 1 << slotBits
+    uint64_t idCount;  // ids 数组的长度
+};
+
+struct DeletionSlot
+{
+    uint64_t hash;  // 变体的哈希（0 表示空槽）
+    uint32_t begin; // 该变体的词编号在 ids 中的起始下标
+    uint32_t count; // 词编号个数
+};
+
+/**
+ *  生成 word 删除至多 maxDist 个字符得到的所有变体（含 word 本身）的哈希
+ *
+ *  1. 哈希为按码点计算的 FNV-1a，不构造变体字符串
+ *  2. 删除不同位置可能得到相同的变体，结果已排序去重
+ */
+inline vector<uint64_t> deletionHashes(const u32string &word, int maxDist)
+{
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    vector<uint64_t> hashes;
+    vector<size_t> deleted; // 升序的删除位置
+    auto emit = [&]() {
+        uint64_t hash = FNV_OFFSET;
+        for (size_t idx = 0, next = 0; idx < word.size(); ++idx)
+        {
+            if (next < deleted.size() && deleted[next] == idx)
+            {
+                ++next;
+                continue;
+            }
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                hash ^= (word[idx] >> shift) & 0xff;
+                hash *= FNV_PRIME;
+            }
+        }
+        hashes.push_back(hash == 0 ? 1 : hash); // 0 留给空槽
+    };
+    auto generate = [&](auto &self, size_t from) -> void {
+        emit();
+        if ((int)deleted.size() >= maxDist)
+            return;
+        for (size_t idx = from; idx < word.size(); ++idx)
+        {
+            deleted.push_back(idx);
+            self(self, idx + 1);
+            deleted.pop_back();
+        }
+    };
+    generate(generate, 0);
+
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    return hashes;
+}
+
+/*************************************************************
+ *
+ *  删除变体索引类（在线部分，只读）
+ *
+ *  1. 整个文件通过 mmap 映射，启动时不解析、不分配内存
+ *  2. 文件可选，未配置或损坏时 available() 为 false
+ *
+ *************************************************************/
+class DeletionIndex
+{
+public:
+    DeletionIndex();
+    ~DeletionIndex();
+
+    bool load(const string &);
+    bool available() const;
+    int maxDist() const;
+
+    void lookup(uint64_t, vector<uint32_t> &) const;
+
+private:
+    const char *_data; // 文件的映射地址
+    size_t _size;
+    const DeletionHeader *_header;
+    const DeletionSlot *_slots;
+    const uint32_t *_ids;
+    uint64_t _slotMask;
+};
+}; // namespace wdcpp
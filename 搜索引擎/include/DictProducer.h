@@ -30,6 +30,8 @@ public:
     void buildIndex();
     void storeDict(const char * filepath);
     void storeIndex(const char *filepath);
+    void storeDeletes(const char *filepath, int maxDist);
+    void storeCompletions(const char *filepath, size_t topK);
 
 private:
     void getFiles(string dir);//获取文件绝对路径
@@ -1,5 +1,10 @@
 #pragma once
+#include "DeletionIndex.h"
+#include "CompletionTrie.h"
+
+#include <stdint.h>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <set>
@@ -11,20 +16,44 @@ using std::map;
 using std::pair;
 using std::set;
 using std::string;
+using std::unordered_map;
+using std::u32string;
 using std::vector;
 
 namespace wdcpp
 {
+/*************************************************************
+ *
+ *  词典类（单例）
+ *
+ *  1. _dict 为 <词, 词频>，_index 为 <字, 含该字的词的编号>
+ *  2. 加载时为每个词生成首尾补位的字符二元组（q-gram，q = 2），建立
+ *     <二元组, 词编号> 索引，供关键词推荐做计数过滤：长度为 L 的词有 L + 1 个
+ *     二元组，编辑距离为 k 的两个词至少共有 max(L1, L2) + 1 - 2k 个二元组
+ *  3. 若配置了 dictDeletes，映射离线生成的删除变体索引（SymSpell）
+ *  4. 若配置了 dictCompletions，映射离线生成的前缀补全 trie
+ *
+ *************************************************************/
 class Dictionary
 {
 public:
     static Dictionary *getInstance();
     static void destory();
 
+    static uint64_t gramKey(char32_t first, char32_t second)
+    {
+        return ((uint64_t)first << 32) | second;
+    }
+    static const char32_t GRAM_PAD = 0; // 词首、词尾的补位字符
+
     ~Dictionary(){};
     /* void initDict(const string &dictPath); */
     const vector<pair<string, int>> &getDict();
+    const vector<u32string> &getCodepoints();
     const map<string, set<int>> &getIndexTable();
+    const unordered_map<uint64_t, vector<int>> &getGramIndex();
+    const DeletionIndex &getDeletionIndex();
+    const CompletionTrie &getCompletionTrie();
     void print()
     {
         for (auto it = _dict.begin(); it != _dict.end(); ++it)
@@ -39,6 +68,9 @@ public:
 private:
     void initDict();
     void initIndex();
+    void initGramIndex();
+    void initDeletionIndex();
+    void initCompletionTrie();
 #if 0
     size_t nBytesCode(const char ch);
     size_t length(const string &str);
@@ -50,7 +82,11 @@ private:
     Dictionary(){}; //单例类
     static Dictionary *_singletonDict;
     vector<pair<string, int>> _dict;
+    vector<u32string> _codepoints; // 与 _dict 一一对应，预先解码的词（计算编辑距离时无需再解码 UTF-8）
     map<string, set<int>> _index; //分别加载词典文件与索引文件
+    unordered_map<uint64_t, vector<int>> _gramIndex; // <二元组, 词编号>（升序，词中出现几次就记几次）
+    DeletionIndex _deletionIndex;                    // 删除变体索引（可选）
+    CompletionTrie _completionTrie;                  // 前缀补全 trie（可选）
     /* vector<string> _isVisited; */
 };
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace wdcpp
+{
+using PageID = long;
+
+/**
+ *  网页的只读视图
+ *
+ *  1. 所有字段都指向 DocStore 的 _arena，不拷贝网页文本
+ *  2. 只在 DocStore 存活期间有效
+ */
+struct DocView
+{
+    PageID docID;
+    string_view doc; // <doc>...</doc>
+    string_view title;
+    string_view url;
+    string_view content;
+};
+
+/*************************************************************
+ *
+ *  网页存储类（在线部分）
+ *
+ *  1. 将整个网页库一次性读入一块连续内存 _arena
+ *  2. 借助偏移库记录每篇网页及其各字段在 _arena 中的位置
+ *  3. 通过 getDoc 获取网页的只读视图 DocView
+ *  4. 偏移库第四列为静态排名（可缺省），docid 越小静态排名越高
+ *
+ *************************************************************/
+class DocStore
+{
+public:
+    DocStore() = default;
+
+    void load(const string &, const string &);
+
+    DocView getDoc(PageID) const;
+    double getStaticRank(PageID) const;
+    size_t size() const;
+
+private:
+    struct Field // 字段在 _arena 中的位置
+    {
+        size_t beg;
+        size_t len;
+    };
+    struct DocEntry
+    {
+        PageID docID;
+        Field doc;
+        Field title;
+        Field url;
+        Field content;
+        double staticRank; // 与查询无关的静态排名，范围 [0, 1]
+    };
+
+    bool parseDoc(size_t, size_t, DocEntry &) const;
+    string_view view(const Field &) const;
+
+private:
+    string _arena;             // 网页库的全部文本
+    vector<DocEntry> _entries; // 下标即 docid
+};
+}; // namespace wdcpp
@@ -4,13 +4,12 @@
 #include "WebPageSearcher.h"
 #include "TimerThread.h"
 #include "KeyRecommander.h"
+#include "AsyncRedis.h"
 
-#include <sw/redis++/redis++.h>
 #include <iostream>
 using std::cin;
 using std::cout;
 using std::endl;
-using namespace sw::redis;
 
 namespace wdcpp
 {
@@ -19,13 +18,16 @@ class EchoServer
 public:
     EchoServer(const string &, unsigned short);
 
-    void start();
-    void stop();
+    void start(); // 收到 SIGINT/SIGTERM 后调用 stop，并返回
 
     void onConnection(const TcpConnectionPtr &);
     void onMessage(const TcpConnectionPtr &);
     void onClose(const TcpConnectionPtr &);
 
+private:
+    void stop();
+    void waitSignal();
+
 private:
     const size_t INIT_WORKER_NUM = 5;
     const size_t INIT_TASKQUEUE_CAPACITY = 10;
@@ -33,7 +35,10 @@ private:
     TcpServer _server;
     WebPageSearcher _webPageSearcher;
     KeyRecommander _recommander; // v1
-    sw::redis::Redis _redis;
+    AsyncRedis _redis; // 由专门的 redis 线程批量访问 redis（地址为配置项 redis）
+    size_t _pageSize;    // 每页网页数（配置项 pagesize，启动时读入一次）
+    size_t _queryBudget; // 网页查询的默认时间预算（配置项 querybudget，毫秒）
     TimerThread _timerThread;
+    Thread _signalThread; // 等待 SIGINT/SIGTERM，收到后退出事件循环
 };
 } // namespace wdcpp
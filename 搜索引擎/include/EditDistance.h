@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+using std::pair;
+using std::u32string;
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  编辑距离类（Myers / Hyyrö 位并行算法）
+ *
+ *  1. 以查询词（码点序列）为模式串预处理一次，之后与任意多个候选词比较，
+ *     每次比较只做 O(候选词长度) 次位运算，不分配内存
+ *  2. 模式串不超过 64 个字符时用一个 64 位字表示一整列；更长的模式串
+ *     退化为按行滚动的动态规划（复用本线程的缓冲区）
+ *  3. distance(text, maxDist) 为有界版本：一旦能确定结果超过 maxDist
+ *     （长度差或当前列的下界已超过）立即返回 maxDist + 1
+ *
+ *************************************************************/
+class EditDistance
+{
+public:
+    explicit EditDistance(const u32string &pattern);
+
+    int distance(const u32string &text) const;
+    int distance(const u32string &text, int maxDist) const;
+
+    size_t size() const
+    {
+        return _pattern.size();
+    }
+
+private:
+    uint64_t peq(char32_t) const;
+    int myers(const u32string &, int) const;
+    int dynamic(const u32string &, int) const;
+
+private:
+    static const size_t WORD_BITS = 64;
+    static const size_t ASCII_SIZE = 128;
+
+    u32string _pattern;
+    uint64_t _asciiPeq[ASCII_SIZE];           // ASCII 字符在模式串中出现位置的位图
+    vector<pair<char32_t, uint64_t>> _widePeq; // 非 ASCII 字符的位图（按码点升序，二分查找）
+};
+}; // namespace wdcpp
@@ -4,6 +4,7 @@
 #include "MutexLockGuard.h"
 
 #include <sys/epoll.h>
+#include <atomic>
 #include <vector>
 #include <map>
 using std::map;
@@ -23,6 +24,7 @@ namespace wdcpp
 class EventLoop
 {
     friend void TcpConnection::notifyLoop(const string &);
+    friend void TcpConnection::notifyLoop(const FrameHeader &, const string &);
 
 public:
     using EventLoopCallBack = TcpConnection::TcpConnectionCallBack;
@@ -64,7 +66,7 @@ private:
     int _epFd;                         // 监听集合（红黑树根节点）
     int _eventFd;                      // 内核计数器
     Acceptor &_acceptor;               // 接收器
-    bool _isLooping;                   // 循环开启标志
+    std::atomic<bool> _isLooping;      // 循环开启标志（构造时为 true，unloop 由其他线程置为 false）
     EventList _eventList;              // 就绪事件链表
     ConnectionMap _connMap;            // 已连接集合
 
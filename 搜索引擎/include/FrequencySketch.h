@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  访问频率估计器（count-min sketch，TinyLFU 使用）
+ *
+ *  1. DEPTH 行计数器，每行按键的哈希值选一个计数器，估计值取各行的最小值
+ *  2. 保守更新：只增加等于最小值的计数器；计数器上限为 MAX_COUNT
+ *  3. 老化：累计增加 _sampleSize 次后所有计数器减半，使频率反映近期的访问
+ *  4. 宽度取不小于容量的 2 的幂，每个缓存记录约占 DEPTH 个字节
+ *
+ *************************************************************/
+class FrequencySketch
+{
+    static const size_t DEPTH = 4;
+    static const uint8_t MAX_COUNT = 15;
+
+public:
+    explicit FrequencySketch(size_t);
+
+    void increment(size_t);
+    uint32_t frequency(size_t) const;
+    void clear();
+
+private:
+    size_t indexOf(size_t, size_t) const;
+    void age();
+
+private:
+    vector<uint8_t> _table; // DEPTH 行，每行 _mask + 1 个计数器
+    size_t _mask;
+    size_t _additions;  // 上次老化以来的增加次数
+    size_t _sampleSize; // 老化周期
+};
+}; // namespace wdcpp
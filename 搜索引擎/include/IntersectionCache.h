@@ -0,0 +1,118 @@
+#pragma once
+#include "MutexLock.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+using std::list;
+using std::shared_ptr;
+using std::unordered_map;
+using std::vector;
+
+namespace wdcpp
+{
+using PageID = long;
+using TermID = uint32_t;
+
+/**
+ *  两个词倒排列表交集的已知前缀
+ */
+struct IntersectionPrefix
+{
+    vector<PageID> IDs; // 交集中小于 bound 的全部 docid（升序）
+    PageID bound;       // 已求交到的位置
+    bool complete;      // 交集已全部求出（此时 bound 无意义）
+};
+
+/*************************************************************
+ *
+ *  倒排列表交集缓存类（单例类）
+ *
+ *  1. 缓存两个词倒排列表的交集（升序的 docid）的已知前缀，键为排好序的两个词编号，
+ *     与查询中的其余词无关："a b c" 与 "a b d" 可共用 a ∩ b
+ *  2. 交集由 IntersectionCursor 惰性求出：提前结束的热门查询只求已扫描的部分，
+ *     缓存的也只是这一段前缀；之后扫描得更远的查询接着求交，并写回更长的前缀
+ *  3. 每条记录带有索引的版本号（generation），版本号不同视为未命中
+ *  4. 按键的 hash 值分为 SHARD_NUM 个分片，每个分片一把锁、各自做 LRU 淘汰
+ *  5. 统计命中与未命中次数（定时任务中输出到日志）
+ *
+ *************************************************************/
+class IntersectionCache
+{
+    friend class IntersectionCursor;
+    static const size_t SHARD_NUM = 16;
+
+public:
+    using PrefixPtr = shared_ptr<const IntersectionPrefix>;
+
+    static IntersectionCache *getInstance();
+
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+
+private:
+    IntersectionCache();
+    ~IntersectionCache() {}
+
+    static void destroy();
+    static uint64_t keyOf(TermID, TermID);
+
+    PrefixPtr lookup(uint64_t, uint64_t);
+    void store(uint64_t, uint64_t, const PrefixPtr &);
+
+private:
+    struct Entry
+    {
+        uint64_t key; // 两个词编号，小者在高 32 位
+        uint64_t generation;
+        PrefixPtr prefix;
+    };
+    struct Shard
+    {
+        list<Entry> entryList; // 头部为最近访问的记录
+        unordered_map<uint64_t, list<Entry>::iterator> hashMap;
+        MutexLock mutex;
+    };
+
+    size_t _capacityPerShard; // 每个分片的最大记录数
+    Shard _shards[SHARD_NUM];
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    static IntersectionCache *_pInstance;
+};
+
+/*************************************************************
+ *
+ *  交集游标类：按 docid 升序逐个给出两个词倒排列表的交集
+ *
+ *  1. 先给出缓存的前缀，用完后从前缀的 bound 处接着求交（以较短的列表驱动，
+ *     在较长的列表中倍增步长后二分查找，即 galloping）
+ *  2. 调用方随时可以停止取下一个；析构时若求出了比缓存更长的前缀则写回缓存
+ *  3. 只在一个线程中使用，构造时取得的前缀由 shared_ptr 持有，不受淘汰影响
+ *
+ *************************************************************/
+class IntersectionCursor
+{
+public:
+    IntersectionCursor(TermID, const vector<PageID> &, TermID, const vector<PageID> &, uint64_t);
+    ~IntersectionCursor();
+
+    bool next(PageID &); // 没有下一个时返回 false
+
+private:
+    const vector<PageID> &_shorter;
+    const vector<PageID> &_longer;
+    uint64_t _key;
+    uint64_t _generation;
+    IntersectionCache::PrefixPtr _cached; // 缓存的前缀（可能为空）
+    size_t _cachedPos;                    // 下一个给出的缓存前缀下标
+    size_t _shorterPos;                   // 下一个求交的 _shorter 下标
+    vector<PageID>::const_iterator _low;  // _longer 中可能等于下一个元素的最小位置
+    vector<PageID> _extension;            // 本次在缓存前缀之后求出的部分
+    PageID _bound;
+    bool _complete;
+};
+}; // namespace wdcpp
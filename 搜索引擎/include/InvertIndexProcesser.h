@@ -1,4 +1,5 @@
 #pragma once
+#include "WebPage.h"
 
 #include <iostream>
 #include <unordered_map>
@@ -14,17 +15,30 @@ using std::vector;
 
 namespace wdcpp
 {
-class WebPage;
-using PageID = long;
+/**
+ *  一个 <word, docid> 的位置索引记录
+ */
+struct EncodedPositions
+{
+    string data;     // 编码后的位置列表
+    uint32_t anchor; // 在原文 content 中第一次出现的字节偏移（见 PositionIndex.h）
+};
+
 /*************************************************************
  *
  *  倒排索引库生成类
  *
+ *  1. 每一项记录 w' 与词频（BM25 使用），同时统计每篇文章的长度（单词数）
+ *  2. 若网页记录了单词位置，则同时生成位置索引（差值 + 变长整数编码）及摘要锚点
+ *
  *************************************************************/
 class InvertIndexProcesser
 {
 public:
-    explicit InvertIndexProcesser(vector<WebPage> &, unordered_map<string, unordered_map<PageID, double>> &);
+    InvertIndexProcesser(vector<WebPage> &,
+                         unordered_map<string, unordered_map<PageID, Posting>> &,
+                         unordered_map<string, unordered_map<PageID, EncodedPositions>> &,
+                         vector<size_t> &);
     ~InvertIndexProcesser()
     {
         using namespace std;
@@ -35,9 +49,14 @@ public:
 
     void printInvertIndexTable();
 
+private:
+    void buildPositionTable();
+
 private:
     vector<WebPage> &_pageList;
-    unordered_map<string, unordered_map<PageID, double>> &_invertIndexTable;
+    unordered_map<string, unordered_map<PageID, Posting>> &_invertIndexTable;
+    unordered_map<string, unordered_map<PageID, EncodedPositions>> &_positionTable; // 位置索引 <word, <docid, 编码后的位置列表>>
+    vector<size_t> &_docLengths;         // 每篇文章的长度（去除停用词后的单词数）
     vector<double> _sumOfWeightsPerPage; // 每篇文章中所有单词的 w 的平方和
 };
 }; // namespace wdcpp
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string_view>
+using std::string;
+using std::string_view;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  流式 json 写入类
+ *
+ *  1. 直接把字段追加到调用者提供的缓冲区 out 中，不构造 json 树，
+ *     字段按写入顺序输出（无需 fifo_map）
+ *  2. 默认输出紧凑格式；pretty 为 true 时按 4 个空格缩进（与 dump(4) 相同）
+ *  3. 除缓冲区扩容外不分配内存，缓冲区可跨请求复用（先 clear 再写）
+ *  4. 字符串按 json 规则转义，UTF-8 多字节字符原样输出
+ *  5. 一个字符串值可分段写入：beginString / appendString / endString
+ *
+ *************************************************************/
+class JsonWriter
+{
+public:
+    explicit JsonWriter(string &out, bool pretty = false)
+        : _out(out),
+          _pretty(pretty),
+          _depth(0),
+          _needComma(false),
+          _afterKey(false)
+    {
+    }
+
+    JsonWriter &beginObject()
+    {
+        separate();
+        _out += '{';
+        enter();
+        return *this;
+    }
+
+    JsonWriter &endObject()
+    {
+        leave();
+        _out += '}';
+        return *this;
+    }
+
+    JsonWriter &beginArray()
+    {
+        separate();
+        _out += '[';
+        enter();
+        return *this;
+    }
+
+    JsonWriter &endArray()
+    {
+        leave();
+        _out += ']';
+        return *this;
+    }
+
+    JsonWriter &key(string_view name)
+    {
+        separate();
+        _out += '"';
+        escape(name);
+        _out += _pretty ? "\": " : "\":";
+        _afterKey = true;
+        return *this;
+    }
+
+    JsonWriter &value(string_view str)
+    {
+        beginString();
+        escape(str);
+        return endString();
+    }
+
+    JsonWriter &value(const char *str)
+    {
+        return value(string_view(str));
+    }
+
+    JsonWriter &value(uint64_t number)
+    {
+        char buf[24];
+        int len = ::snprintf(buf, sizeof(buf), "%llu", (unsigned long long)number);
+        return raw(string_view(buf, len));
+    }
+
+    JsonWriter &value(int64_t number)
+    {
+        char buf[24];
+        int len = ::snprintf(buf, sizeof(buf), "%lld", (long long)number);
+        return raw(string_view(buf, len));
+    }
+
+    JsonWriter &value(int number)
+    {
+        return value((int64_t)number);
+    }
+
+    JsonWriter &value(bool flag)
+    {
+        return raw(flag ? "true" : "false");
+    }
+
+    JsonWriter &null()
+    {
+        return raw("null");
+    }
+
+    /**
+     *  原样写入一个已序列化的 json 值（如子响应）
+     */
+    JsonWriter &raw(string_view json)
+    {
+        separate();
+        _out.append(json.data(), json.size());
+        _needComma = true;
+        return *this;
+    }
+
+    JsonWriter &beginString()
+    {
+        separate();
+        _out += '"';
+        return *this;
+    }
+
+    JsonWriter &appendString(string_view str)
+    {
+        escape(str);
+        return *this;
+    }
+
+    JsonWriter &endString()
+    {
+        _out += '"';
+        _needComma = true;
+        return *this;
+    }
+
+private:
+    /**
+     *  写值或键之前：补上逗号与缩进（键之后的值不需要）
+     */
+    void separate()
+    {
+        if (_afterKey)
+        {
+            _afterKey = false;
+            return;
+        }
+        if (_needComma)
+            _out += ',';
+        if (_pretty && _depth > 0)
+            newline();
+    }
+
+    void enter()
+    {
+        ++_depth;
+        _needComma = false;
+    }
+
+    void leave()
+    {
+        --_depth;
+        if (_pretty && _needComma) // 非空容器，闭括号另起一行
+            newline();
+        _needComma = true;
+    }
+
+    void newline()
+    {
+        _out += '\n';
+        _out.append(_depth * 4, ' ');
+    }
+
+    void escape(string_view str)
+    {
+        static const char HEX[] = "0123456789abcdef";
+        size_t beg = 0; // 尚未写入的第一个字节
+        for (size_t idx = 0; idx < str.size(); ++idx)
+        {
+            unsigned char ch = str[idx];
+            if (ch >= 0x20 && ch != '"' && ch != '\\')
+                continue;
+
+            _out.append(str.data() + beg, idx - beg);
+            beg = idx + 1;
+            switch (ch)
+            {
+            case '"':
+                _out += "\\\"";
+                break;
+            case '\\':
+                _out += "\\\\";
+                break;
+            case '\n':
+                _out += "\\n";
+                break;
+            case '\r':
+                _out += "\\r";
+                break;
+            case '\t':
+                _out += "\\t";
+                break;
+            case '\b':
+                _out += "\\b";
+                break;
+            case '\f':
+                _out += "\\f";
+                break;
+            default:
+                _out += "\\u00";
+                _out += HEX[ch >> 4];
+                _out += HEX[ch & 0xf];
+                break;
+            }
+        }
+        _out.append(str.data() + beg, str.size() - beg);
+    }
+
+private:
+    string &_out;
+    bool _pretty;
+    size_t _depth;
+    bool _needComma; // 当前容器中已有元素，下一个元素前需要逗号
+    bool _afterKey;  // 刚写完键，接下来写它的值
+};
+}; // namespace wdcpp
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Dictionary.h"
+#include "Protocol.h"
+#include "EditDistance.h"
 #include <string>
 #include <queue>
 #include <vector>
@@ -16,13 +18,13 @@ namespace wdcpp
 class MyResult
 {
 public:
-    MyResult(string word, int freq, int dist = 999)
-        : _word(word), _freq(freq), _dist(dist)
+    MyResult(const string &word, int freq, int dist = 999)
+        : _word(&word), _freq(freq), _dist(dist)
     {
     }
-    string getWord() const
+    const string &getWord() const
     {
-        return _word;
+        return *_word;
     }
     int getFreq() const
     {
@@ -38,7 +40,7 @@ public:
     }
 
 private:
-    string _word; //查询到的单词
+    const string *_word; //查询到的单词（指向词典中的词，不拷贝）
     int _freq;    //单词频率
     int _dist;    //编辑距离
 };
@@ -70,22 +72,38 @@ struct MyCompare
     }
 };
 
+// 与 MyCompare 相反：堆顶为最差的结果（用于只保留前 k 个结果的有界堆）
+struct MyReverseCompare
+{
+    bool operator()(const MyResult &lhs, const MyResult &rhs)
+    {
+        return MyCompare()(rhs, lhs);
+    }
+};
+using TopKHeap = priority_queue<MyResult, vector<MyResult>, MyReverseCompare>;
+
 class KeyRecommander
 {
 public:
-    KeyRecommander() = default;
+    KeyRecommander();
     ~KeyRecommander() = default;
-    string doQuery(const string &); //执行查询
+    string doQuery(const string &, WireFormat = WireFormat::Json); //执行查询，结果按 format 序列化
+    string doComplete(const string &, WireFormat = WireFormat::Json); //前缀补全，结果格式与 doQuery 相同
 
 private:
     void queryIndexTable();                                                                                                //查询索引
-    void statistic(const string &queryWord, set<int> &, priority_queue<MyResult, vector<MyResult>, MyCompare> &resultQue); //进行计算
-    size_t nBytesCode(const char ch);
-    size_t length(const std::string &str);
-    int triple_min(const int &a, const int &b, const int &c);
-    int distance(const string &, const string &rhs); //计算最小编辑距离
+    vector<int> getCandidates(const u32string &); //生成候选词
+    vector<int> getCandidatesByDeletes(const u32string &, const DeletionIndex &); //由删除变体索引生成候选词
+    vector<int> getCandidatesByGrams(const u32string &); //由二元组索引生成候选词
+    vector<MyResult> statistic(const EditDistance &queryWord, const vector<int> &); //进行计算，返回最好的 _maxKeyNum 个结果
+    void pushTopK(TopKHeap &, const MyResult &);
 
-    string serializeForNoting();
-    string serialize(const vector<string> &);
+    string serializeForNoting(WireFormat);
+    string serialize(const vector<string> &, WireFormat);
+
+private:
+    bool _prettyJson; // 响应是否缩进（默认紧凑格式）
+    int _maxKeyDist;  // 推荐词与关键词的最大编辑距离（决定二元组计数过滤的阈值）
+    size_t _maxKeyNum; // 推荐词个数
 };
 };
@@ -0,0 +1,77 @@
+#pragma once
+#include "MutexLock.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <string>
+#include <unordered_map>
+using std::list;
+using std::string;
+using std::unordered_map;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  关键词推荐的进程内缓存（一级缓存，单例类）
+ *
+ *  1. 缓存 <关键词缓存键, 序列化后的推荐结果>，redis 作为各进程共享的二级缓存
+ *  2. 每条记录带有过期时刻，有效期与 redis 中的记录相同（配置项 keywordttl，默认 60 秒），
+ *     过期的记录在访问时删除
+ *  3. 按键的 hash 值分为 SHARD_NUM 个分片，每个分片一把锁、各自做 LRU 淘汰，
+ *     所有工作线程共享
+ *  4. 分别统计一级缓存与 redis 的命中与未命中次数（定时任务中输出到日志）
+ *
+ *************************************************************/
+class KeywordCache
+{
+    static const size_t SHARD_NUM = 16;
+    using Clock = std::chrono::steady_clock;
+
+public:
+    static KeywordCache *getInstance();
+
+    bool get(const string &, string &);
+    void put(const string &, const string &);
+
+    size_t getTTL() const;
+
+    void recordRedis(bool);
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getRedisHits() const;
+    uint64_t getRedisMisses() const;
+
+private:
+    KeywordCache();
+    ~KeywordCache() {}
+
+    static void destroy();
+
+private:
+    struct Entry
+    {
+        string key;
+        string value;
+        Clock::time_point expireAt;
+    };
+
+    struct Shard
+    {
+        list<Entry> entryList; // 头部为最近访问的记录
+        unordered_map<string, list<Entry>::iterator> hashMap;
+        MutexLock mutex;
+    };
+
+    size_t _capacityPerShard; // 每个分片的最大记录数
+    size_t _ttl;              // 记录的有效期（秒）
+    Shard _shards[SHARD_NUM];
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    std::atomic<uint64_t> _redisHits;
+    std::atomic<uint64_t> _redisMisses;
+    static KeywordCache *_pInstance;
+};
+}; // namespace wdcpp
@@ -1,45 +1,156 @@
 #pragma once
+#include "FrequencySketch.h"
 
+#include <stdint.h>
 #include <string>
-#include <unordered_map>
-#include <list>
-#include <utility>
-using std::list;
-using std::pair;
+#include <vector>
+#include <memory>
+#include <functional>
+using std::shared_ptr;
 using std::string;
-using std::unordered_map;
+using std::vector;
 
 namespace wdcpp
 {
 class CacheManager;
+
+/**
+ *  cache 的淘汰策略（配置项 cachepolicy）
+ */
+enum class CachePolicy
+{
+    Lru,    // 普通 LRU（默认）
+    TinyLfu // W-TinyLFU，并按重新计算的开销加权
+};
+
+/**
+ *  cache 的可选配置
+ */
+struct CacheOptions
+{
+    CachePolicy policy = CachePolicy::Lru;
+    size_t byteBudget = 0;    // 字节预算（0 表示只按记录数限制）
+    size_t compressBytes = 0; // 不小于该长度的结果压缩存放（0 表示不压缩）
+};
+
 /*************************************************************
  *
  *  cache 类
  *
+ *  1. 记录存放在构造时一次分配好的 _entries 中（slab），满后淘汰的记录槽直接复用，
+ *     插入不再分配链表 / 哈希表结点
+ *  2. LRU 链表为 _entries 下标组成的侵入式双向链表（头部为最近使用）
+ *  3. 索引为开放寻址哈希表（线性探测，删除时后移填补，无墓碑），存放 _entries 下标；
+ *     记录中保存键的哈希值，每次操作只计算一次哈希
+ *  4. 结果以 shared_ptr<const string> 保存和返回，命中时不复制结果字符串；
+ *     同一结果可在多个 cache 之间共享
+ *  5. 带 size_t 参数的重载使用调用者已算好的键哈希（std::hash<string>）
+ *  6. W-TinyLFU 策略下记录分为三段，各自一条 LRU 链表：
+ *     - 窗口（约 1% 容量）：新记录先进入窗口
+ *     - 试用段：窗口满时，窗口尾部记录与试用段尾部记录比较 "频率 × 开销权重"，
+ *       较大者留下（进入试用段），较小者被淘汰；频率由 FrequencySketch 估计
+ *     - 保护段（约主区的 80%）：试用段中再次命中的记录升入保护段，保护段满时
+ *       尾部记录降回试用段
+ *     开销为计算该结果所用的时间（微秒），开销权重随其对数增长，使重新计算代价高的
+ *     结果更容易留下；LRU 策略下所有记录都在窗口段中，不使用频率和开销
+ *  7. 设置字节预算时，每条记录按实际占用（记录槽 + 键 + 存放的结果）计入，超出预算时
+ *     按淘汰策略淘汰记录直到不超出；记录数仍不超过构造时的容量（slab 大小）
+ *  8. 设置压缩阈值时，较长的结果以 LZ4 压缩存放（压缩后没有变小则原样存放），
+ *     命中时解压出一份新的结果；压缩依赖 liblz4，为编译选项：编译时定义 USE_LZ4
+ *     并链接 liblz4（-DUSE_LZ4 -llz4），否则不压缩
+ *
  *************************************************************/
 class LRUCache
 {
     friend class CacheManager;
 
-    using Record = pair<string, string>;
-    using iterator = list<Record>::iterator;
-
 public:
-    LRUCache(size_t);
+    using Value = shared_ptr<const string>;
+
+    LRUCache(size_t, const CacheOptions & = CacheOptions());
 
-    bool isHit(const string &);
+    bool isHit(const string &) const;
 
-    string getRecord(const string &);
+    Value getRecord(const string &); // 未命中时返回空指针
+    Value getRecord(const string &, size_t);
     void insertRecord(const string &, const string &);
-    void load(const string &);
-    void dump(const string &);
+    void insertRecord(const string &, const Value &, uint32_t = 0);
+    void insertRecord(const string &, const Value &, uint32_t, size_t);
     void update(const LRUCache &);
     void clear();
     size_t size() const;
+    size_t bytes() const; // 当前计入预算的字节数
+
+    /**
+     *  按从最久未使用到最近使用的顺序访问每条记录 func(key, value, cost)
+     *  （W-TinyLFU 策略下依次为试用段、保护段、窗口）
+     */
+    template <typename Func>
+    void forEach(Func &&func) const
+    {
+        for (int segment : {PROBATION, PROTECTED, WINDOW})
+        {
+            for (uint32_t idx = _tail[segment]; idx != NIL; idx = _entries[idx].prev)
+            {
+                Value value = unpack(_entries[idx]);
+                if (value)
+                    func(_entries[idx].key, value, _entries[idx].cost);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    enum Segment
+    {
+        WINDOW,
+        PROBATION,
+        PROTECTED,
+        SEGMENT_NUM
+    };
+
+    struct Entry
+    {
+        string key;
+        Value value;      // 存放的结果（可能是压缩后的）
+        uint32_t rawSize; // 压缩前的长度（0 表示未压缩）
+        size_t hash;      // 键的哈希值
+        uint32_t prev;    // LRU 链表中的前一条（更近使用）
+        uint32_t next;    // LRU 链表中的后一条（更久未使用）
+        uint32_t cost;    // 计算该结果所用的时间（微秒）
+        uint8_t segment;  // 所在的段
+    };
+
+    size_t probe(const string &, size_t) const;
+    void eraseIndex(uint32_t);
+    void unlink(uint32_t);
+    void pushFront(uint32_t, int);
+    void touch(uint32_t);
+    uint32_t evict();
+    uint64_t score(uint32_t) const;
+    void shrink();
+    void release(uint32_t);
+    size_t charge(uint32_t) const;
+    Value pack(const Value &, uint32_t &) const;
+    Value unpack(const Entry &) const;
 
 private:
-    list<Record> _resultList;
-    unordered_map<string, iterator> _hashMap;
+    vector<Entry> _entries;      // 记录槽（slab）
+    vector<uint32_t> _freeSlots; // 空闲的记录槽
+    vector<uint32_t> _index;     // 开放寻址哈希表，NIL 为空槽
+    size_t _mask;                // _index.size() - 1
+    uint32_t _head[SEGMENT_NUM]; // 各段最近使用的记录
+    uint32_t _tail[SEGMENT_NUM]; // 各段最久未使用的记录
+    size_t _segmentSize[SEGMENT_NUM];
+    size_t _size;
     size_t _capacity;
+    size_t _bytes;         // 当前计入预算的字节数
+    size_t _byteBudget;    // 字节预算（0 表示不限）
+    size_t _compressBytes; // 压缩阈值（0 表示不压缩）
+    CachePolicy _policy;
+    size_t _windowCapacity;    // 窗口的最大记录数（LRU 策略下为全部容量）
+    size_t _protectedCapacity; // 保护段的最大记录数
+    FrequencySketch _sketch;   // 访问频率（只在 W-TinyLFU 策略下使用）
 };
 }; // namespace wdcpp
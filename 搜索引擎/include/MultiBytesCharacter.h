@@ -1,5 +1,15 @@
 #pragma once
 
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+using std::u32string;
+using std::vector;
+
 namespace wdcpp
 {
 /**
@@ -32,7 +42,7 @@ inline size_t nBytesCode(const char ch)
  *
  *  1. limit 是能返回的最大字节数，若所求超过 limit 则直接返回 limit
  */
-size_t howManyBytesWithNCharacter(const char *p, size_t limit, size_t N)
+inline size_t howManyBytesWithNCharacter(const char *p, size_t limit, size_t N)
 {
     size_t totalChar = 0;
     for (size_t i = 0; i < N; ++i)
@@ -51,11 +61,11 @@ size_t howManyBytesWithNCharacter(const char *p, size_t limit, size_t N)
  *
  *  1. 第 end 个字节一定是某个字符的起始字节
  */
-vector<size_t> getPosPerCharactor(const string &str, size_t end)
+inline vector<size_t> getPosPerCharactor(string_view str, size_t end)
 {
     vector<size_t> res;
     int totalChar = 0;
-    const char *p = str.c_str();
+    const char *p = str.data();
     for (size_t idx = 0; idx < end; ++idx)
     {
         int nBytes = nBytesCode(p[0]);
@@ -67,4 +77,137 @@ vector<size_t> getPosPerCharactor(const string &str, size_t end)
     return res;
 }
 
+/**
+ *  获取 str 中第 end 个字节往前 N 个字符的起始字节
+ *
+ *  1. 第 end 个字节一定是某个字符的起始字节
+ *  2. 只向前扫描 N 个字符（跳过 UTF-8 后续字节 10xxxxxx），不必从头遍历
+ *  3. 不足 N 个字符时返回 0
+ */
+inline size_t backwardPosWithNCharacter(string_view str, size_t end, size_t N)
+{
+    size_t pos = end;
+    for (size_t i = 0; i < N && pos > 0; ++i)
+    {
+        --pos;
+        while (pos > 0 && (str[pos] & 0xC0) == 0x80)
+            --pos;
+    }
+    return pos;
+}
+
+/**
+ *  将 UTF-8 字符串解码为码点序列（用于按字符比较，如编辑距离）
+ *
+ *  1. 解码结果追加到 out 中，out 可跨调用复用
+ *  2. 末尾的残缺字符按已有的字节解码，不丢弃
+ */
+inline void decodeUtf8(string_view str, u32string &out)
+{
+    for (size_t idx = 0; idx < str.size();)
+    {
+        size_t nBytes = nBytesCode(str[idx]);
+        if (nBytes > 4 || idx + nBytes > str.size())
+            nBytes = std::min(nBytes, str.size() - idx);
+
+        char32_t code = nBytes == 1 ? (unsigned char)str[idx] : (str[idx] & (0x7f >> nBytes));
+        for (size_t off = 1; off < nBytes; ++off)
+            code = (code << 6) | (str[idx + off] & 0x3f);
+        out.push_back(code);
+        idx += nBytes;
+    }
+}
+
+inline u32string decodeUtf8(string_view str)
+{
+    u32string res;
+    res.reserve(str.size());
+    decodeUtf8(str, res);
+    return res;
+}
+
+/**
+ *  字符规范化（建索引与查询时使用同一规则）
+ *
+ *  1. 全角 ASCII 字符（U+FF01 ~ U+FF5E）转为对应的半角字符
+ *  2. 大写英文字母转为小写
+ *  3. 空白（含全角空格 U+3000）合并为一个空格，并去掉首尾空白
+ *  4. 规范化结果按段交给 emit(data, len, srcIdx)，srcIdx 为该段对应的原字符在 str 中的
+ *     字节偏移（合并的空格取第一个空白字符）；emit 返回 false 时停止
+ */
+template <typename Emit>
+inline void foldEach(string_view str, Emit emit)
+{
+    bool started = false;       // 是否已写入过非空白字符
+    size_t spacePos = SIZE_MAX; // 待写入的空格对应的原字节偏移（SIZE_MAX 表示没有）
+    for (size_t idx = 0; idx < str.size();)
+    {
+        size_t nBytes = nBytesCode(str[idx]);
+        if (idx + nBytes > str.size()) // 末尾的残缺字符
+            nBytes = str.size() - idx;
+
+        char ch = 0; // 规范化后的单字节字符（为 0 表示保留原字符）
+        if (nBytes == 1)
+            ch = str[idx];
+        else if (nBytes == 3)
+        {
+            unsigned code = ((str[idx] & 0x0f) << 12) | ((str[idx + 1] & 0x3f) << 6) | (str[idx + 2] & 0x3f);
+            if (code == 0x3000)
+                ch = ' ';
+            else if (code >= 0xff01 && code <= 0xff5e)
+                ch = (char)(code - 0xfee0);
+        }
+
+        if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+        {
+            if (started && spacePos == SIZE_MAX)
+                spacePos = idx;
+        }
+        else
+        {
+            if (spacePos != SIZE_MAX)
+            {
+                if (!emit(" ", 1, spacePos))
+                    return;
+                spacePos = SIZE_MAX;
+            }
+            if (ch != 0)
+                ch = (ch >= 'A' && ch <= 'Z') ? (char)(ch + 32) : ch;
+            if (!(ch == 0 ? emit(str.data() + idx, nBytes, idx) : emit(&ch, 1, idx)))
+                return;
+            started = true;
+        }
+        idx += nBytes;
+    }
+}
+
+inline string foldCharacters(string_view str)
+{
+    string res;
+    res.reserve(str.size());
+    foldEach(str, [&res](const char *data, size_t len, size_t) {
+        res.append(data, len);
+        return true;
+    });
+    return res;
+}
+
+/**
+ *  规范化结果 foldCharacters(str) 中每个字节对应的 str 中的字节偏移
+ *
+ *  1. 建位置索引时用于把位置（规范化后的偏移）映射回原文，整篇文本只扫描一次
+ *  2. 原样保留的字符逐字节对应，转换后的单字节字符对应原字符的起点
+ */
+inline vector<uint32_t> unfoldTable(string_view str)
+{
+    vector<uint32_t> res;
+    res.reserve(str.size());
+    foldEach(str, [&res](const char *, size_t len, size_t srcIdx) {
+        for (size_t idx = 0; idx < len; ++idx)
+            res.push_back(srcIdx + idx);
+        return true;
+    });
+    return res;
+}
+
 }; // namespace wdcpp
@@ -3,38 +3,77 @@
 #include "WebPageSearcher.h"
 #include "KeyRecommander.h"
 #include "Dictionary.h"
+#include "Deadline.h"
+#include "Protocol.h"
+#include "AsyncRedis.h"
+#include "ThreadPool.h"
+#include "LRUCache.h"
 
-#include <unistd.h>
-
-#include <sw/redis++/redis++.h>
 #include <unistd.h>
 #include <iostream>
 using std::cout;
 using std::endl;
-using namespace sw::redis;
 
 namespace wdcpp
 {
+/*************************************************************
+ *
+ *  请求处理任务（交给线程池执行）
+ *
+ *  msgID 1：关键词推荐    msgID 2：网页查询（首页）
+ *  msgID 3：翻页          msgID 4：批量请求（msg 为多个子请求）
+ *  msgID 5：前缀补全
+ *
+ *  请求可以是 json（小火车协议）或二进制协议，二者都先解码为 WireRequest，
+ *  响应按请求所用的协议序列化；两种格式的结果分别缓存
+ *
+ *  关键词推荐一级缓存未命中时不等待 redis：把任务的副本作为回调交给 AsyncRedis
+ *  后即返回，redis 命中则在 redis 线程中直接回复，未命中再交回线程池查词典
+ *
+ *************************************************************/
 class MyTask
 {
 public:
-    MyTask(const string &msg, const TcpConnectionPtr &connPtr, WebPageSearcher &webPageSearcher, KeyRecommander &recommander, sw::redis::Redis &redis)
-        : _msg(msg),
+    MyTask(Message &&msg, const TcpConnectionPtr &connPtr, WebPageSearcher &webPageSearcher, KeyRecommander &recommander, AsyncRedis &redis,
+           ThreadPool &pool, size_t pageSize, size_t queryBudget)
+        : _msg(std::move(msg)),
           _connPtr(connPtr),
           _webPageSearcher(webPageSearcher),
           _recommander(recommander),
-          _redis(redis)
-
+          _redis(redis),
+          _pool(pool),
+          _pageSize(pageSize),
+          _queryBudget(queryBudget),
+          _arrivalTime(Deadline::now())
     {
     }
 
     void process(); // 由子线程（TheadPoll）调用！！！
 
 private:
-    string _msg;
+    bool decode(WireRequest &);
+    void reply(const string &);
+    string cacheKey(const string &) const;
+
+    bool doKeyword(const string &, string &);
+    void onRedisReply(const string &, const string &, const sw::redis::OptionalString &);
+    void recommend(const string &, const string &);
+    string doRecommend(const string &, const string &);
+    string doSearch(const ParsedQuery &, size_t, size_t, const Deadline &);
+    string doBatch(const WireRequest &);
+
+    size_t limitOf(const WireRequest &) const;
+    Deadline deadlineOf(const WireRequest &) const;
+
+private:
+    Message _msg;
     TcpConnectionPtr _connPtr;
     WebPageSearcher &_webPageSearcher;
     KeyRecommander &_recommander;
-    sw::redis::Redis &_redis;
+    AsyncRedis &_redis;
+    ThreadPool &_pool; // redis 未命中后在其中查词典
+    size_t _pageSize;    // 每页网页数（客户未指定 limit 时使用）
+    size_t _queryBudget; // 网页查询的默认时间预算（毫秒，客户未指定 budget 时使用，0 表示不限时）
+    Deadline::Clock::time_point _arrivalTime; // 请求到达时刻（在 IO 线程中构造 MyTask 时记录）
 };
 }; // namespace wdcpp
@@ -11,7 +11,7 @@ namespace wdcpp
  *
  *  网页库类
  *
- *  1. 包含三个网页库数据
+ *  1. 包含三个网页库数据（以及可选的位置索引）
  *  2. 包含三个网页库生成类对象
  *
  *************************************************************/
@@ -31,7 +31,9 @@ public:
 private:
     vector<WebPage> _pageList;                                              // 网页库
     vector<pair<size_t, size_t>> _offsetTable;                              // 网页偏移库
-    unordered_map<string, unordered_map<PageID, double>> _invertIndexTable; // 倒排索引库
+    unordered_map<string, unordered_map<PageID, Posting>> _invertIndexTable; // 倒排索引库 <word, <docid, <w', 词频>>>
+    unordered_map<string, unordered_map<PageID, EncodedPositions>> _positionTable;    // 位置索引（可选）
+    vector<size_t> _docLengths;                                             // 每篇文章的长度
     DirScanner _dirScanner;
     PageProcesser _pageProcesser;
     InvertIndexProcesser _invertIndexProcesser;
@@ -5,7 +5,9 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <unordered_map>
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 namespace wdcpp
@@ -33,9 +35,11 @@ public:
 
 private:
     void loadStopWords();
+    void loadSourceWeights();
 
     void loadPageFromXML();  // 加载网页
     void cutRedundantPage(); // 网页去重
+    void computeStaticRank(); // 计算静态排名，并按静态排名重新分配 docid
     void countFrequence();   // 统计词频
 
 private:
@@ -43,6 +47,8 @@ private:
     vector<WebPage> &_nonRepetivepageList;
     vector<WebPage> _pageList;
     vector<string> _stopWords;
+    bool _withPositions; // 是否记录单词位置（配置了 positions 时才生成位置索引）
+    unordered_map<string, double> _sourceWeights; // <RSS 文件名, 来源权重>（静态排名用）
     // vector<bool> _isDelete;
     CompareSimhash _comparePages; // 网页比较器
     SplitTool _splitTool;         // 分词器
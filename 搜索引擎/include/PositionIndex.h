@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace wdcpp
+{
+using PageID = long;
+
+/*************************************************************
+ *
+ *  位置索引
+ *
+ *  1. 记录每个 <word, docid> 中 word 的位置：规范化后的 title / content 中的字节偏移，
+ *     content 中的位置加上 CONTENT_POSITION_BASE（见 VarInt.h）
+ *  2. 位置列表经差值 + 变长整数编码存放于 positions.dat
+ *  3. positionsIndex.dat 为偏移表，文件格式（本机字节序，可直接 mmap）：
+ *       PositionHeader
+ *       PositionWord[wordCount]     按单词的字节序升序
+ *       PositionEntry[entryCount]   每个单词对应一段按 docid 升序的记录
+ *       char names[nameBytes]       所有单词的拼接
+ *  4. 每条记录另存锚点：该词在原文 content 中第一次出现的字节偏移（未经规范化），
+ *     生成摘要时直接使用，无需把位置映射回原文
+ *
+ *************************************************************/
+const uint32_t POSITION_MAGIC = 0x50534457; // "WDSP"
+const uint32_t POSITION_VERSION = 1;
+const uint32_t NO_ANCHOR = UINT32_MAX; // 该词只出现在 title 中
+
+struct PositionHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t wordCount;  // PositionWord 的个数
+    uint64_t entryCount; // PositionEntry 的个数
+    uint64_t nameBytes;  // names 的长度
+};
+
+struct PositionWord
+{
+    uint64_t nameOffset; // 单词在 names 中的起始字节
+    uint32_t nameLength; // 单词的字节数
+    uint32_t count;      // 记录条数
+    uint64_t begin;      // 第一条记录在 PositionEntry 数组中的下标
+};
+
+struct PositionEntry
+{
+    int64_t docid;
+    uint64_t offset; // 位置列表在 positions.dat 中的起始字节
+    uint32_t anchor; // 在原文 content 中第一次出现的字节偏移（NO_ANCHOR 表示没有）
+    uint32_t unused;
+};
+
+/*************************************************************
+ *
+ *  位置索引类（在线部分）
+ *
+ *  1. positions.dat 与 positionsIndex.dat 都通过 mmap 映射，启动时加载，
+ *     不解析、不分配内存；查表为两次二分查找
+ *  2. 位置索引是可选的，未配置或文件损坏时查询退化为不使用位置信息
+ *  3. 加载后只读，可由多个工作线程共享
+ *
+ *************************************************************/
+class PositionIndex
+{
+public:
+    PositionIndex();
+    ~PositionIndex();
+
+    bool load(const string &, const string &);
+    bool isLoaded() const;
+
+    bool getPositions(const string &, PageID, vector<uint32_t> &) const;
+    uint32_t getAnchor(const string &, PageID) const;
+
+private:
+    const PositionEntry *findEntry(string_view, PageID) const;
+
+private:
+    const char *_data;  // positions.dat 的映射地址
+    size_t _size;       // positions.dat 的长度
+    const char *_table; // positionsIndex.dat 的映射地址
+    size_t _tableSize;  // positionsIndex.dat 的长度
+    const PositionHeader *_header;
+    const PositionWord *_words;
+    const PositionEntry *_entries;
+    const char *_names;
+};
+}; // namespace wdcpp
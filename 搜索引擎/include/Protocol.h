@@ -0,0 +1,374 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  二进制协议（与 json 小火车协议并存）
+ *
+ *  1. 每帧以 16 字节的小端帧头开始：
+ *       magic(4) version(1) flags(1) type(2) requestID(4) length(4)
+ *     其后为 length 字节的报文体，type 即 msgID，requestID 原样带回
+ *  2. 服务端读出每帧的前 4 字节：等于 WIRE_MAGIC 则按二进制帧处理，
+ *     否则视为 json 小火车协议的车头，响应沿用请求所用的协议
+ *  3. 报文体中的整数一律按小端编码，字符串为 u32 长度 + 字节，
+ *     因此不同字节序、不同字长的机器之间可以互通
+ *  4. 版本协商：服务端只解析不高于 WIRE_VERSION 的请求，否则回复
+ *     msgID 505（报文体带服务端版本），客户端据此降级
+ *
+ *  请求报文体（数值字段取 WIRE_DEFAULT 表示使用服务端默认值）：
+ *     1：msg
+ *     5：msg（前缀补全）
+ *     2：msg offset(u32) limit(u32) budget(u32)
+ *     3：msg cursor(u64) offset(u32) limit(u32) budget(u32)
+ *     4：budget(u32) count(u32) { type(u16) length(u32) 子请求报文体 } ...
+ *        （子请求不能再是批量请求，个数不超过 WIRE_MAX_BATCH；json 请求同样限制）
+ *
+ *  响应报文体（均以 u16 msgID 开头，与帧头的 type 相同）：
+ *     100：count(u32) { word } ...
+ *     200：cursor(u64) total(u32) offset(u32) partial(u8) count(u32) { title url summary } ...
+ *     404：partial(u8) msg
+ *     300：count(u32) { length(u32) 子响应报文体 } ...（length 为 0 表示无结果）
+ *     400：msg（请求无法解析）
+ *     505：version(u8)
+ *
+ *************************************************************/
+const uint32_t WIRE_MAGIC = 0x45534457;      // 线上字节依次为 "WDSE"
+const uint8_t WIRE_VERSION = 1;              // 当前协议版本
+const size_t WIRE_HEADER_SIZE = 16;          // 帧头字节数
+const uint32_t WIRE_DEFAULT = UINT32_MAX;    // 数值字段使用服务端默认值
+const size_t WIRE_MAX_BODY = 64 * 1024 * 1024; // 单帧报文体上限（超过视为坏帧）
+const size_t WIRE_MAX_BATCH = 256;             // 批量请求中子请求个数的上限
+
+enum class WireFormat
+{
+    Json,  // 小火车协议（size_t 车头 + json）
+    Binary // 二进制协议
+};
+
+struct FrameHeader
+{
+    uint32_t magic = WIRE_MAGIC;
+    uint8_t version = WIRE_VERSION;
+    uint8_t flags = 0; // 保留
+    uint16_t type = 0; // msgID
+    uint32_t requestID = 0;
+    uint32_t length = 0;
+};
+
+/**
+ *  收到的一条消息（两种协议统一表示）
+ */
+struct Message
+{
+    WireFormat format = WireFormat::Json;
+    FrameHeader header; // 仅二进制协议有效
+    string body;
+    bool valid = false; // 帧头是否完整、合法
+};
+
+/**
+ *  一条请求（由 json 或二进制报文体解码得到）
+ */
+struct WireRequest
+{
+    uint16_t msgID = 0;
+    string msg;
+    uint64_t cursor = 0;
+    uint32_t offset = 0;
+    uint32_t limit = WIRE_DEFAULT;
+    uint32_t budget = WIRE_DEFAULT;
+    vector<WireRequest> subRequests; // 仅批量请求
+};
+
+inline void storeU16(char *buf, uint16_t value)
+{
+    buf[0] = (char)(value & 0xff);
+    buf[1] = (char)(value >> 8);
+}
+
+inline void storeU32(char *buf, uint32_t value)
+{
+    for (int idx = 0; idx < 4; ++idx)
+        buf[idx] = (char)((value >> (8 * idx)) & 0xff);
+}
+
+inline uint16_t loadU16(const char *buf)
+{
+    const unsigned char *ptr = (const unsigned char *)buf;
+    return (uint16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+inline uint32_t loadU32(const char *buf)
+{
+    const unsigned char *ptr = (const unsigned char *)buf;
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+inline void encodeFrameHeader(const FrameHeader &header, char *buf)
+{
+    storeU32(buf, header.magic);
+    buf[4] = (char)header.version;
+    buf[5] = (char)header.flags;
+    storeU16(buf + 6, header.type);
+    storeU32(buf + 8, header.requestID);
+    storeU32(buf + 12, header.length);
+}
+
+inline FrameHeader decodeFrameHeader(const char *buf)
+{
+    FrameHeader header;
+    header.magic = loadU32(buf);
+    header.version = (uint8_t)buf[4];
+    header.flags = (uint8_t)buf[5];
+    header.type = loadU16(buf + 6);
+    header.requestID = loadU32(buf + 8);
+    header.length = loadU32(buf + 12);
+    return header;
+}
+
+/*************************************************************
+ *
+ *  二进制报文体写入类
+ *
+ *  1. 直接追加到调用者提供的缓冲区 out 中
+ *  2. 一个字符串可分段写入：beginString / appendString / endString
+ *     （先占 4 字节长度，endString 时回填）
+ *
+ *************************************************************/
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(string &out)
+        : _out(out),
+          _stringPos(0)
+    {
+    }
+
+    BinaryWriter &putU8(uint8_t value)
+    {
+        _out += (char)value;
+        return *this;
+    }
+
+    BinaryWriter &putU16(uint16_t value)
+    {
+        char buf[2];
+        storeU16(buf, value);
+        _out.append(buf, sizeof(buf));
+        return *this;
+    }
+
+    BinaryWriter &putU32(uint32_t value)
+    {
+        char buf[4];
+        storeU32(buf, value);
+        _out.append(buf, sizeof(buf));
+        return *this;
+    }
+
+    BinaryWriter &putU64(uint64_t value)
+    {
+        putU32((uint32_t)(value & 0xffffffff));
+        return putU32((uint32_t)(value >> 32));
+    }
+
+    BinaryWriter &putString(string_view str)
+    {
+        putU32((uint32_t)str.size());
+        _out.append(str.data(), str.size());
+        return *this;
+    }
+
+    BinaryWriter &beginString()
+    {
+        _stringPos = _out.size();
+        return putU32(0);
+    }
+
+    BinaryWriter &appendString(string_view str)
+    {
+        _out.append(str.data(), str.size());
+        return *this;
+    }
+
+    BinaryWriter &endString()
+    {
+        storeU32(&_out[_stringPos], (uint32_t)(_out.size() - _stringPos - 4));
+        return *this;
+    }
+
+private:
+    string &_out;
+    size_t _stringPos; // 正在写入的字符串的长度字段位置
+};
+
+/*************************************************************
+ *
+ *  二进制报文体读取类
+ *
+ *  1. 越界时置 _good 为 false，此后所有读取均失败
+ *
+ *************************************************************/
+class BinaryReader
+{
+public:
+    explicit BinaryReader(string_view in)
+        : _in(in),
+          _pos(0),
+          _good(true)
+    {
+    }
+
+    bool getU8(uint8_t &value)
+    {
+        if (!require(1))
+            return false;
+        value = (uint8_t)_in[_pos++];
+        return true;
+    }
+
+    bool getU16(uint16_t &value)
+    {
+        if (!require(2))
+            return false;
+        value = loadU16(_in.data() + _pos);
+        _pos += 2;
+        return true;
+    }
+
+    bool getU32(uint32_t &value)
+    {
+        if (!require(4))
+            return false;
+        value = loadU32(_in.data() + _pos);
+        _pos += 4;
+        return true;
+    }
+
+    bool getU64(uint64_t &value)
+    {
+        uint32_t low = 0, high = 0;
+        if (!getU32(low) || !getU32(high))
+            return false;
+        value = ((uint64_t)high << 32) | low;
+        return true;
+    }
+
+    bool getString(string_view &str)
+    {
+        uint32_t length = 0;
+        if (!getU32(length) || !require(length))
+            return false;
+        str = _in.substr(_pos, length);
+        _pos += length;
+        return true;
+    }
+
+    bool getString(string &str)
+    {
+        string_view view;
+        if (!getString(view))
+            return false;
+        str.assign(view.data(), view.size());
+        return true;
+    }
+
+    bool good() const
+    {
+        return _good;
+    }
+
+    bool atEnd() const
+    {
+        return _pos == _in.size();
+    }
+
+private:
+    bool require(size_t count)
+    {
+        if (_good && _in.size() - _pos < count)
+            _good = false;
+        return _good;
+    }
+
+private:
+    string_view _in;
+    size_t _pos;
+    bool _good;
+};
+
+/**
+ *  解码二进制请求报文体（不允许批量请求嵌套）
+ */
+inline bool decodeRequest(uint16_t msgID, string_view body, WireRequest &request, bool nested = false)
+{
+    BinaryReader reader(body);
+    request.msgID = msgID;
+    if (1 == msgID || 5 == msgID)
+        reader.getString(request.msg);
+    else if (2 == msgID || 3 == msgID) // 读取失败后 reader 不再读取，最后统一检查 good()
+    {
+        reader.getString(request.msg);
+        if (3 == msgID)
+            reader.getU64(request.cursor);
+        reader.getU32(request.offset);
+        reader.getU32(request.limit);
+        reader.getU32(request.budget);
+    }
+    else if (4 == msgID && !nested)
+    {
+        uint32_t count = 0;
+        if (!reader.getU32(request.budget) || !reader.getU32(count) ||
+            count > WIRE_MAX_BATCH || count > (body.size() - 8) / 6) // 每个子请求至少 6 字节（type + length）
+            return false;
+        request.subRequests.reserve(count);
+        for (uint32_t idx = 0; idx < count; ++idx) // 逐个解码后再放入，不按声明的个数预先分配
+        {
+            uint16_t subID = 0;
+            string_view subBody;
+            WireRequest sub;
+            if (!reader.getU16(subID) || !reader.getString(subBody) || !decodeRequest(subID, subBody, sub, true))
+                return false;
+            request.subRequests.push_back(std::move(sub));
+        }
+    }
+    else
+        return false;
+    return reader.good() && reader.atEnd();
+}
+
+/**
+ *  编码二进制请求报文体（客户端使用）
+ */
+inline void encodeRequest(const WireRequest &request, string &body)
+{
+    BinaryWriter writer(body);
+    if (1 == request.msgID || 5 == request.msgID)
+        writer.putString(request.msg);
+    else if (2 == request.msgID)
+        writer.putString(request.msg).putU32(request.offset).putU32(request.limit).putU32(request.budget);
+    else if (3 == request.msgID)
+        writer.putString(request.msg).putU64(request.cursor).putU32(request.offset)
+            .putU32(request.limit).putU32(request.budget);
+    else if (4 == request.msgID)
+    {
+        writer.putU32(request.budget).putU32((uint32_t)request.subRequests.size());
+        for (auto &sub : request.subRequests)
+        {
+            writer.putU16(sub.msgID).beginString();
+            encodeRequest(sub, body);
+            writer.endString();
+        }
+    }
+}
+}; // namespace wdcpp
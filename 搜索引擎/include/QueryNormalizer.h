@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using std::unordered_set;
+
+namespace wdcpp
+{
+using TermID = uint32_t; // 倒排索引中单词的编号
+
+class SplitTool;
+
+/**
+ *  规范化后的查询语句
+ */
+struct ParsedQuery
+{
+    string text;                         // 字符规范化后的查询语句（用于日志）
+    string key;                          // 规范化缓存键（结果相同的查询得到相同的 key）
+    unordered_map<string, int> wordsMap; // 分词并去除停用词后的 <word, freq>
+    bool phrase = false;                 // 是否为精确短语查询（查询语句被英文双引号包围）
+    vector<pair<string, uint32_t>> phraseTerms; // 短语查询中的 <word, 相对短语开头的字节偏移>
+};
+
+/*************************************************************
+ *
+ *  查询规范化类
+ *
+ *  1. 字符规范化（全角转半角、大写转小写、合并空白）
+ *  2. 先对整句做字符规范化再分词（与建索引时 WebPage::splitWord 的顺序相同），
+ *     只分词一次（分词结果经 SegmentCache 缓存），去除停用词，统计词频
+ *  3. 将单词映射为 TermID 并排序，生成与词序无关的缓存键
+ *  4. 被英文双引号包围的查询为短语查询，额外记录每个词的相对偏移，
+ *     其缓存键以 '"' 开头，不与同词的普通查询共用缓存
+ *
+ *************************************************************/
+class QueryNormalizer
+{
+public:
+    QueryNormalizer(SplitTool &, const unordered_set<string> &, const unordered_map<string, TermID> &);
+
+    ParsedQuery normalize(const string &) const;
+
+private:
+    SplitTool &_splitTool;
+    const unordered_set<string> &_stopWords;
+    const unordered_map<string, TermID> &_termIDs;
+};
+}; // namespace wdcpp
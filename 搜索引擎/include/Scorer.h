@@ -0,0 +1,180 @@
+#pragma once
+#include "WebPage.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace wdcpp
+{
+using PageID = long;
+
+/**
+ *  打分算法（由配置项 scorer 选择，默认 cosine）
+ */
+enum class ScorerType
+{
+    Cosine,
+    BM25
+};
+
+inline ScorerType toScorerType(const string &name)
+{
+    if (name == "bm25" || name == "BM25")
+        return ScorerType::BM25;
+    return ScorerType::Cosine;
+}
+
+/**
+ *  语料统计信息（加载索引时确定，查询时只读）
+ */
+struct CorpusStats
+{
+    size_t docNum = 0;          // 文章总数
+    double avgDocLength = 0.0;  // 平均文章长度（单词数，建库时计算，BM25 使用）
+    vector<uint32_t> docLengths; // 下标为 docid 的文章长度（BM25 使用）
+};
+
+/**
+ *  参与打分的一个查询词
+ */
+struct ScoringTerm
+{
+    const unordered_map<PageID, Posting> *entries; // 倒排索引中该词的 <docid, <w', 词频>>
+    int queryFreq;                                // 查询语句中该词的词频
+    double idf;                                   // 加载索引时预先计算好的 IDF
+    double queryWeight;                           // 查询侧权重（由 prepare 计算）
+};
+
+/*************************************************************
+ *
+ *  打分核心
+ *
+ *  1. 每种算法是一个普通类，提供相同的四个成员：
+ *     idf      加载索引时为每个词预先计算 IDF
+ *     prepare  每次查询计算一次查询侧权重
+ *     maxScore 本次查询任意文章得分的上界（提前结束用）
+ *     score    对一篇候选文章打分（热循环）
+ *  2. WebPageSearcher::getSortedIDs 以打分核心为模板参数，每次查询只按
+ *     ScorerType 分派一次，热循环中没有虚函数调用，score 可被内联
+ *  3. 新增算法：增加一个同样接口的类，并在 ScorerType 与分派处各加一项
+ *
+ *************************************************************/
+
+/**
+ *  TF-IDF 余弦相似度（与离线部分生成的 w' 配合使用）
+ */
+class CosineScorer
+{
+public:
+    explicit CosineScorer(const CorpusStats &) {}
+
+    static double idf(const CorpusStats &stats, size_t df)
+    {
+        size_t N = stats.docNum + 1; // 把查询语句也视为一篇文章
+        size_t DF = df + 1;
+        if (N == DF)
+            return 0.0;
+        return log10((double)N / (DF + 1));
+    }
+
+    /**
+     *  查询向量 X：w = TF * IDF，再归一化为 w'
+     */
+    void prepare(vector<ScoringTerm> &terms) const
+    {
+        double sumWeight = 0.0;
+        for (auto &term : terms)
+        {
+            double TF = (double)term.queryFreq / terms.size();
+            term.queryWeight = TF * term.idf;
+            sumWeight += term.queryWeight * term.queryWeight;
+        }
+        for (auto &term : terms)
+            term.queryWeight = sumWeight == 0.0 ? 0.0 : term.queryWeight / sqrt(sumWeight);
+    }
+
+    double maxScore(const vector<ScoringTerm> &) const
+    {
+        return 1.0; // 余弦相似度不超过 1
+    }
+
+    double score(const vector<ScoringTerm> &terms, PageID id) const
+    {
+        double innerProduct = 0, lengthXAbs = 0, lengthYAbs = 0;
+        for (auto &term : terms)
+        {
+            double y = 0.0;
+            auto pageIt = term.entries->find(id);
+            if (pageIt != term.entries->end())
+                y = pageIt->second.weight;
+            innerProduct += term.queryWeight * y;
+            lengthXAbs += term.queryWeight * term.queryWeight;
+            lengthYAbs += y * y;
+        }
+        if (lengthXAbs == 0.0 || lengthYAbs == 0.0)
+            return 0.0;
+        return innerProduct / (sqrt(lengthXAbs) * sqrt(lengthYAbs));
+    }
+};
+
+/**
+ *  Okapi BM25（需要离线部分生成的文章长度，词频与 w' 一起存放在倒排索引中）
+ */
+class BM25Scorer
+{
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+public:
+    explicit BM25Scorer(const CorpusStats &stats)
+        : _stats(stats),
+          _avgDocLength(stats.avgDocLength > 0.0 ? stats.avgDocLength : 1.0)
+    {
+    }
+
+    static double idf(const CorpusStats &stats, size_t df)
+    {
+        return log(1.0 + ((double)stats.docNum - df + 0.5) / (df + 0.5));
+    }
+
+    void prepare(vector<ScoringTerm> &terms) const
+    {
+        for (auto &term : terms)
+            term.queryWeight = term.idf * term.queryFreq;
+    }
+
+    double maxScore(const vector<ScoringTerm> &terms) const
+    {
+        double result = 0.0; // 词频趋于无穷时每项趋于 queryWeight * (K1 + 1)
+        for (auto &term : terms)
+            result += term.queryWeight * (K1 + 1);
+        return result;
+    }
+
+    double score(const vector<ScoringTerm> &terms, PageID id) const
+    {
+        double docLength = (size_t)id < _stats.docLengths.size() ? _stats.docLengths[id] : _avgDocLength;
+        double norm = K1 * (1 - B + B * docLength / _avgDocLength); // 文章长度归一化
+        double result = 0.0;
+        for (auto &term : terms)
+        {
+            auto pageIt = term.entries->find(id);
+            if (pageIt == term.entries->end())
+                continue;
+            double tf = pageIt->second.freq;
+            result += term.queryWeight * tf * (K1 + 1) / (tf + norm);
+        }
+        return result;
+    }
+
+private:
+    const CorpusStats &_stats;
+    double _avgDocLength;
+};
+}; // namespace wdcpp
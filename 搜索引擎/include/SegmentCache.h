@@ -0,0 +1,76 @@
+#pragma once
+#include "MutexLock.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+using std::list;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace wdcpp
+{
+class SplitTool;
+
+/**
+ *  分词结果中的一个词
+ */
+struct Segment
+{
+    string word;     // jieba 切出的原始词（未做字符规范化）
+    uint32_t offset; // 在原句中的字节偏移
+};
+using SegmentList = vector<Segment>;
+using SegmentListPtr = shared_ptr<const SegmentList>;
+
+/*************************************************************
+ *
+ *  分词缓存类（单例类）
+ *
+ *  1. 缓存 <已规范化的语句, jieba 分词结果>，命中时跳过 CutForSearch
+ *  2. 只缓存分词本身（与停用词、倒排索引无关），网页查询与关键词推荐都可使用
+ *  3. 按语句的 hash 值分为 SHARD_NUM 个分片，每个分片一把锁、各自做 LRU 淘汰
+ *  4. 统计命中与未命中次数（定时任务中输出到日志）
+ *
+ *************************************************************/
+class SegmentCache
+{
+    static const size_t SHARD_NUM = 16;
+
+public:
+    static SegmentCache *getInstance();
+
+    SegmentListPtr cut(const string &, SplitTool &);
+
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+
+private:
+    SegmentCache();
+    ~SegmentCache() {}
+
+    static void destroy();
+
+private:
+    struct Shard
+    {
+        list<pair<string, SegmentListPtr>> entryList; // 头部为最近访问的语句
+        unordered_map<string, list<pair<string, SegmentListPtr>>::iterator> hashMap;
+        MutexLock mutex;
+    };
+
+    size_t _capacityPerShard; // 每个分片的最大记录数
+    Shard _shards[SHARD_NUM];
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    static SegmentCache *_pInstance;
+};
+}; // namespace wdcpp
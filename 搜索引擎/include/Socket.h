@@ -22,6 +22,7 @@ public:
 
     int fd() const;
     void shutDownWrite();
+    void shutDown();
     void setNonBlock();
 
 private:
@@ -24,6 +24,7 @@ public:
     SplitTool();
 
     vector<string> cut(const string &);
+    vector<Word> cutWithOffset(const string &); // 分词并给出每个词在 sentence 中的字节偏移
 
 private:
     Jieba _jieba;
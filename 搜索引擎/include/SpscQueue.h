@@ -0,0 +1,64 @@
+#pragma once
+#include "NonCopyable.h"
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+using std::vector;
+
+namespace wdcpp
+{
+/*************************************************************
+ *
+ *  单生产者单消费者无锁环形队列
+ *
+ *  1. 只允许一个线程 push、一个线程 pop，二者无需加锁
+ *  2. 容量在构造时确定（向上取 2 的幂），队列满时 push 返回 false
+ *  3. _tail 只由生产者写、_head 只由消费者写，分别放在不同的 cache line 上
+ *
+ *************************************************************/
+template <typename T>
+class SpscQueue
+    : NonCopyable
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : _mask(0),
+          _head(0),
+          _tail(0)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        _slots.resize(size);
+        _mask = size - 1;
+    }
+
+    bool push(T &&value) // 由生产者调用
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) > _mask) // 已满
+            return false;
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) // 由消费者调用
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) // 为空
+            return false;
+        value = std::move(_slots[head & _mask]);
+        _slots[head & _mask] = T(); // 及时释放元素持有的资源
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    vector<T> _slots;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head; // 下一个读取位置（消费者）
+    alignas(64) std::atomic<size_t> _tail; // 下一个写入位置（生产者）
+};
+}; // namespace wdcpp
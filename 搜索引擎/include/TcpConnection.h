@@ -2,6 +2,7 @@
 #include "Socket.h"
 #include "SocketIO.h"
 #include "InetAddress.h"
+#include "Protocol.h"
 
 #include <memory>
 #include <functional>
@@ -18,6 +19,8 @@ namespace wdcpp
  *  2. 作为与客户交互的接口，提供 msg 发送/接收的接口
  *  3. 首先要从 Acceptor 中获取 clientSock 再建立该连接类，此后就可以
  *     通过该类与 client 进行交互了
+ *  4. recvMessage 按每帧的前 4 字节区分二进制协议与 json 小火车协议
+ *  5. recvMessage 返回无效消息后字节流已无法再对齐，应调用 shutdown 关闭连接
  *
  *************************************************************/
 class EventLoop; // 前向声明（不要再本文件中直接 #include "EventLoop.h" 以防发生循环引用）
@@ -35,11 +38,14 @@ public:
     explicit TcpConnection(int, EventLoop *);
 
     void send(const string &);
+    void sendFrame(const FrameHeader &, const string &);
     string recv();
+    Message recvMessage();
     string recvLine();
     string show();
 
     bool isClosed() const;
+    void shutdown();
 
     void setConnectionCallBack(const TcpConnectionCallBack &);
     void setMessageCallBack(const TcpConnectionCallBack &);
@@ -49,6 +55,7 @@ public:
     void handleCloseCallBack();
 
     void notifyLoop(const string &);
+    void notifyLoop(const FrameHeader &, const string &);
 
 private:
     InetAddress getLocalAddr();
@@ -60,6 +67,7 @@ private:
     InetAddress _localAddr;
     InetAddress _peerAddr;
     bool _isShutDownWrite;
+    bool _isShutDown; // 已由服务端主动关闭（如收到坏帧）
     TcpConnectionCallBack _onConnectionCb; // 新连接事件的事件处理器（回调函数）
     TcpConnectionCallBack _onMessageCb;    // 新消息事件的事件处理器
     TcpConnectionCallBack _onCloseCb;      // 连接断开事件的事件处理器
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace wdcpp
+{
+/**
+ *  变长整数编码（每字节低 7 位存数据，最高位为 1 表示后面还有字节）
+ *
+ *  1. 将 value 编码后追加到 out 末尾
+ */
+inline void encodeVarint(string &out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/**
+ *  从 p 处解码一个变长整数并将 p 后移
+ *
+ *  1. 数据残缺（超出 end）时返回 false
+ */
+inline bool decodeVarint(const char *&p, const char *end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift <= 28; shift += 7)
+    {
+        uint8_t byte = (uint8_t)*p++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/**
+ *  位置索引中正文位置的起点
+ *
+ *  1. 位置为规范化（foldCharacters）后文本中的字节偏移，与查询中短语的偏移可直接比较
+ *  2. title 中的位置为偏移本身，content 中的位置为 CONTENT_POSITION_BASE + 偏移，
+ *     二者互不重叠，短语不会跨越 title 与 content
+ */
+const uint32_t CONTENT_POSITION_BASE = 0x80000000;
+
+/**
+ *  将升序的位置列表编码为 "个数 + 差值序列"
+ */
+inline void encodePositions(string &out, const vector<uint32_t> &positions)
+{
+    encodeVarint(out, positions.size());
+    uint32_t prev = 0;
+    for (auto pos : positions)
+    {
+        encodeVarint(out, pos - prev);
+        prev = pos;
+    }
+}
+
+/**
+ *  解码 encodePositions 编码的位置列表
+ */
+inline bool decodePositions(const char *p, const char *end, vector<uint32_t> &positions)
+{
+    uint32_t count = 0, delta = 0, pos = 0;
+    if (!decodeVarint(p, end, count))
+        return false;
+    positions.clear();
+    positions.reserve(std::min<size_t>(count, end - p)); // count 来自文件，每个差值至少占 1 字节
+    for (uint32_t idx = 0; idx < count; ++idx)
+    {
+        if (!decodeVarint(p, end, delta))
+            return false;
+        pos += delta;
+        positions.push_back(pos);
+    }
+    return true;
+}
+}; // namespace wdcpp
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -12,6 +13,15 @@ namespace wdcpp
 {
 using PageID = long; // 便于全 wdcpp 空间可访问
 
+/**
+ *  倒排索引中的一项（一个 <word, docid>）
+ */
+struct Posting
+{
+    double weight; // w'（TF-IDF 归一化后的权重，余弦相似度使用）
+    int freq;      // word 在该文章中的词频（BM25 使用）
+};
+
 class RssItem;
 class SplitTool;
 /*************************************************************
@@ -31,20 +41,27 @@ public:
         // cout << "~WebPage()" << endl;
     }
 
-    string getDoc() const;
+    const string &getDoc() const;
     PageID getDocId() const;
-    string getTitle() const;
-    string getUrl() const;
-    string getContent() const;
-    string getSummary() const;
+    const string &getTitle() const;
+    const string &getUrl() const;
+    const string &getContent() const;
+    const string &getSummary() const;
+    const string &getFeedSource() const;
+    size_t getDuplicateNum() const;
+    double getStaticRank() const;
     unordered_map<string, int> &getWordsMap();
+    unordered_map<string, vector<uint32_t>> &getWordPositions();
 
     void setPageID(PageID);
     void setPageDoc();
     void setPageContent(const string &);
     void setPageSummary(const string &);
+    void setFeedSource(const string &);
+    void addDuplicate();
+    void setStaticRank(double);
 
-    void splitWord(SplitTool &, const vector<string> &);
+    void splitWord(SplitTool &, const vector<string> &, bool withPositions = false);
 
     void printWordsMap() const;
 
@@ -55,6 +72,10 @@ private:
     string _docURL;
     string _docContent;
     string _docSummary;                   // 摘要
+    string _feedSource;                   // 来源 RSS 文件（建库时使用）
+    size_t _duplicateNum = 1;             // 去重时被归入本网页的网页数（含自身）
+    double _staticRank = 0.0;             // 与查询无关的静态排名，范围 [0, 1]
     unordered_map<string, int> _wordsMap; // 词频集合 <word, freq>
+    unordered_map<string, vector<uint32_t>> _wordPositions; // 位置集合 <word, 位置>（格式见 VarInt.h 中的 CONTENT_POSITION_BASE）
 };
 }; // namespace wdcpp
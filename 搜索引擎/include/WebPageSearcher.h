@@ -1,15 +1,59 @@
 #pragma once
 #include "WebPage.h"
 #include "SplitTool.h"
+#include "CursorCache.h"
+#include "IntersectionCache.h"
+#include "DocStore.h"
+#include "QueryNormalizer.h"
+#include "PositionIndex.h"
+#include "Scorer.h"
+#include "Deadline.h"
+#include "Protocol.h"
 
 #include <unordered_map>
+#include <unordered_set>
 using std::unordered_map;
+using std::unordered_set;
 
 namespace wdcpp
 {
+/**
+ *  批量查询中的一个网页查询
+ */
+struct PageRequest
+{
+    ParsedQuery query;
+    size_t offset;
+    size_t limit;
+    bool wantRecord = false; // 结果完整时是否生成结果缓存记录
+    string record;           // 输出：结果缓存记录（不需要或结果不完整时为空）
+};
+
 /*************************************************************
  *
+ *  网页查询类
  *
+ *  1. 首次查询（doQuery）时对候选文章排序，将排序结果存入游标缓存，
+ *     只为 [offset, offset + limit) 这一页生成摘要并序列化
+ *  2. 翻页查询（doPage）凭游标取回排序结果，无需重新排序
+ *  3. 查询语句先经 parseQuery 规范化（只分词一次），规范化结果同时
+ *     用作结果缓存的键
+ *  4. 打分算法由配置项 scorer 选择（cosine / bm25），打分核心作为模板参数，
+ *     每次查询只分派一次；各词的 IDF 在加载索引时预先计算
+ *  5. docid 按静态排名从高到低分配：按 docid 顺序遍历倒排列表，当剩余文章
+ *     （静态排名更低）的得分上界不超过当前第 k 名时提前结束
+ *  6. 每次查询带有截止时间，超时后返回已找到的最好结果，并标记为 partial
+ *  7. 批量查询（doBatch）中规范化键相同的查询只检索一次，所有查询共用一张
+ *     <word, 倒排列表> 查找表，每个词只查一次倒排索引
+ *  8. 若配置了位置索引：短语查询只保留精确包含该短语的文章；多词查询按
+ *     查询词在文中的最小覆盖窗口加权；摘要以记录的位置为中心截取（只为当前页的文章求位置）
+ *  9. 结果按调用者指定的 WireFormat 序列化为 json 或二进制报文体
+ *  10. 启动时计算索引的版本号（generation），索引文件或打分配置改变后版本号随之改变，
+ *      缓存快照据此判断是否仍然有效
+ *  11. 结果缓存中的记录不含游标（游标的有效期与容量都远小于结果缓存），而是附带
+ *      排序结果；命中时（doCachedQuery）重新登记排序结果，写入新的游标
+ *  12. 多词查询以两个最稀有词倒排列表的交集驱动，交集随遍历惰性求出，已求出的前缀存入
+ *      交集缓存（按词编号共享、按版本号失效）；只有最短的倒排列表不短于 _intersectionMin 时才求交
  *
  *************************************************************/
 class WebPageSearcher
@@ -18,26 +62,65 @@ public:
     WebPageSearcher();
     ~WebPageSearcher() = default;
 
-    string doQuery(string);
+    ParsedQuery parseQuery(const string &) const;
+
+    string doQuery(const ParsedQuery &, size_t, size_t, WireFormat, const Deadline & = Deadline(), string *record = nullptr);
+    bool doCachedQuery(const ParsedQuery &, const string &, WireFormat, string &);
+    string doPage(CursorCache::Cursor, const string &, size_t, size_t, WireFormat, const Deadline & = Deadline());
+    vector<string> doBatch(vector<PageRequest> &, WireFormat, const Deadline &);
+
+    uint64_t getGeneration() const;
+
+private:
+    struct TermPostings // 一个词在各个索引中的数据（查询期间只读）
+    {
+        const unordered_map<PageID, Posting> *entries = nullptr; // <docid, <w', 词频>>
+        const vector<PageID> *postings = nullptr;               // 升序的 docid
+        double idf = 0.0;
+        TermID id = 0;
+    };
+    using PostingsCache = unordered_map<string, TermPostings>; // 一次（批量）查询内的查找表
 
 private:
     void loadFromFile();
+    void loadDocStats();
+
+    CursorCache::RankedListPtr rank(const ParsedQuery &, const Deadline &, PostingsCache &);
+    const TermPostings *lookupTerm(const string &, PostingsCache &);
+    template <typename Scorer>
+    vector<PageID> getSortedIDs(const ParsedQuery &, bool, bool, const Deadline &, PostingsCache &, bool &);
 
-    unordered_map<string, double> getVectorX(WebPage &);
-    set<PageID> getIDs(WebPage &);
-    vector<PageID> getSortedIDs(const unordered_map<string, double> &, const set<PageID> &);
+    bool matchPhrase(const vector<pair<string, uint32_t>> &, PageID);
+    double getProximityBoost(const unordered_map<string, int> &, PageID);
+    uint32_t getAnchor(PageID, const unordered_map<string, int> &);
 
-    void setSummarys(vector<PageID> &, WebPage &);
+    pair<size_t, size_t> getSummaryRange(const DocView &, const unordered_map<string, int> &, uint32_t);
 
-    string serializeForNoting();
-    string serialize(const vector<PageID> &);
+    string serializeForNoting(bool, WireFormat);
+    string serialize(CursorCache::Cursor, const RankedList &, size_t, size_t, WireFormat, pair<size_t, size_t> * = nullptr);
+    string serializeBinary(CursorCache::Cursor, const RankedList &, size_t, size_t, pair<size_t, size_t> * = nullptr);
 
 private:
-    vector<WebPage> _pageList;
-    // unordered_map<int, pair<int, int>> _offsetTable; // 感觉不需要一直存放在内存
-    unordered_map<string, unordered_map<PageID, double>> _invertIndexTable;
+    DocStore _docStore; // 网页库（整体存放于一块连续内存）
+    unordered_map<string, unordered_map<PageID, Posting>> _invertIndexTable; // <word, <docid, <w', 词频>>>
+    unordered_map<string, vector<PageID>> _postingLists; // 每个单词所在文章的 docid（升序，即静态排名降序）
+    PositionIndex _positionIndex; // 位置索引（可选，启动时映射）
+
+    unordered_map<string, TermID> _termIDs; // 倒排索引中单词的编号（按读入顺序）
+    vector<double> _idf;                    // 下标为 TermID 的 IDF（按所选打分算法预先计算）
+
+    ScorerType _scorerType;
+    CorpusStats _corpusStats;
 
     SplitTool _splitTool;
-    vector<string> _stopWords;
+    unordered_set<string> _stopWords;
+    QueryNormalizer _normalizer;
+
+    double _staticRankWeight; // 静态排名在总分中的权重（相对于查询得分上界）
+    size_t _maxPageNum;       // 排序结果最多保留的文章数
+    size_t _intersectionMin;  // 最短的倒排列表不短于此值时才求交集并缓存（0 表示不求交）
+    bool _prettyJson;         // 响应是否缩进（默认紧凑格式）
+    CursorCache _cursorCache; // 游标缓存（分页查询）
+    uint64_t _generation;     // 索引的版本号
 };
 }; // namespace wdcpp
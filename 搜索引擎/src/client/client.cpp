@@ -1,4 +1,5 @@
 #include "Configuration.h"
+#include "Protocol.h"
 using namespace wdcpp;
 #include "nlohmann/json.hpp"
 #include "fifo_map.hpp"
@@ -31,6 +32,9 @@ using std::string;
 using std::vector;
 
 int netFd; // 全局网络套接字
+size_t pageSize = Configuration::getInstance()->getNumber("pagesize", 5); // 每页显示的网页数
+bool binaryProtocol = Configuration::getInstance()->get("protocol", "json") == "binary"; // 是否使用二进制协议
+uint32_t nextRequestID = 0; // 二进制协议的请求编号
 
 void showMenu()
 {
@@ -39,62 +43,13 @@ void showMenu()
     printf("*     1: Keyword recommendation     *\n");
     printf("*     2: Web page search            *\n");
     printf("*     3: Quit                       *\n");
+    printf("*     4: Recommendation + search    *\n");
+    printf("*     5: Prefix completion          *\n");
     printf("*                                   *\n");
     printf("*************************************\n");
     printf("\n");
 }
 
-/**
- *  分页显示网页查询结果
- */
-void showWithPaging(Json &root)
-{
-    size_t pageNum = root["msg"].size();
-    if (pageNum <= 1)
-        cout << "[ " << pageNum << " page were found ]" << endl;
-    else
-        cout << "[ " << pageNum << " pages were found ]" << endl;
-
-    size_t restNum = pageNum; // 剩余页面数
-
-    for (size_t idx = 0; idx < 5 && idx < pageNum; ++idx, --restNum)
-    {
-        auto &page = root["msg"][idx];
-        cout << "[Title] " << page["title"] << endl;
-        cout << "[url] " << page["url"] << endl;
-        cout << "[Summary] " << page["summary"] << endl
-             << endl;
-    }
-
-    while (restNum > 0)
-    {
-        // 提示还剩 5 篇
-        if (restNum <= 1)
-            cout << "[ " << restNum << " page behind, please input 'n' to show the rest, or 'c' to continue ]" << endl;
-        else
-            cout << "[ " << restNum << " pages behind, please input 'n' to show the rest, or 'c' to continue ]" << endl;
-
-        char opt;
-        cin >> opt;
-        if (opt == 'n')
-        {
-            size_t start = pageNum - restNum;
-            for (size_t idx = start; idx < start + 5 && idx < pageNum; ++idx, --restNum)
-            {
-                auto &page = root["msg"][idx];
-                cout << "[Title] " << page["title"] << endl;
-                cout << "[url] " << page["url"] << endl;
-                cout << "[Summary] " << page["summary"] << endl
-                     << endl;
-            }
-        }
-        else
-            goto end;
-    }
-
-end:;
-}
-
 /**
  *  1. 将 buf 中的恰好 count 个字节写入到 SND 中
  *  2. 返回成功写入的字节数
@@ -176,34 +131,127 @@ size_t recvm(void *buf, size_t count)
 }
 
 /**
- *  发送关键词
+ *  将 json 请求转换为二进制协议的请求（未给出的数值字段取服务端默认值）
  */
-void sendKey(string &key)
+WireRequest toWireRequest(Json &root)
+{
+    WireRequest request;
+    request.msgID = root.value("msgID", 0);
+    request.cursor = root.value("cursor", (uint64_t)0);
+    request.offset = root.value("offset", (uint32_t)0);
+    request.limit = root.value("limit", WIRE_DEFAULT);
+    request.budget = root.value("budget", WIRE_DEFAULT);
+    if (4 == request.msgID)
+    {
+        for (auto &sub : root["msg"])
+            request.subRequests.push_back(toWireRequest(sub));
+    }
+    else
+        request.msg = root.value("msg", string());
+    return request;
+}
+
+/**
+ *  将二进制响应报文体转换为与 json 响应相同结构的 Json（显示部分无需区分协议）
+ */
+Json fromWireResponse(string_view body)
 {
     Json root;
-    root["msgID"] = 1;
-    root["msg"] = key;
-    string msg = root.dump(4);
-#ifdef __DEBUG__
-    printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-    cout << msg << endl;
-#endif
+    BinaryReader reader(body);
+    uint16_t msgID = 0;
+    reader.getU16(msgID);
+    root["msgID"] = msgID;
+
+    uint8_t flag = 0;
+    uint32_t count = 0;
+    string str;
+    if (100 == msgID)
+    {
+        root["msg"] = Json::array();
+        reader.getU32(count);
+        for (uint32_t idx = 0; idx < count && reader.getString(str); ++idx)
+            root["msg"].push_back(str);
+    }
+    else if (200 == msgID)
+    {
+        uint64_t cursor = 0;
+        uint32_t total = 0, offset = 0;
+        reader.getU64(cursor);
+        reader.getU32(total);
+        reader.getU32(offset);
+        reader.getU8(flag);
+        reader.getU32(count);
+        root["cursor"] = cursor;
+        root["total"] = total;
+        root["offset"] = offset;
+        root["partial"] = flag != 0;
+        root["msg"] = Json::array();
+        for (uint32_t idx = 0; idx < count && reader.good(); ++idx)
+        {
+            Json page;
+            reader.getString(str);
+            page["title"] = str;
+            reader.getString(str);
+            page["url"] = str;
+            reader.getString(str);
+            page["summary"] = str;
+            root["msg"].push_back(page);
+        }
+    }
+    else if (404 == msgID)
+    {
+        reader.getU8(flag);
+        reader.getString(str);
+        root["partial"] = flag != 0;
+        root["msg"] = str;
+    }
+    else if (300 == msgID)
+    {
+        root["msg"] = Json::array();
+        reader.getU32(count);
+        string_view sub;
+        for (uint32_t idx = 0; idx < count && reader.getString(sub); ++idx)
+            root["msg"].push_back(sub.empty() ? Json() : fromWireResponse(sub));
+    }
+    else if (400 == msgID)
+    {
+        reader.getString(str);
+        root["msg"] = str;
+    }
+    else if (505 == msgID) // 服务端不支持本客户端的协议版本，此后改用 json
+    {
+        reader.getU8(flag);
+        root["msg"] = "unsupported protocol version, server speaks version " + std::to_string(flag);
+        binaryProtocol = false;
+    }
 
-    const size_t length = msg.size();
-    sendm(&length, sizeof(size_t)); // 发送车头
-    sendm(msg.c_str(), length);     // 发送车厢
+    if (!reader.good())
+        ERROR_PRINT("recv: bad binary response\n");
+    return root;
 }
 
 /**
- *  发送查询词
+ *  发送一条请求（按小火车协议发送 json，或按二进制协议发送一帧）
  */
-void sendQuery(string &query)
+void sendJson(Json &root)
 {
-    Json root;
-    root["msgID"] = 2;
-    root["msg"] = query;
-    string msg = root.dump(4);
+    if (binaryProtocol)
+    {
+        string body;
+        encodeRequest(toWireRequest(root), body);
+
+        FrameHeader header;
+        header.type = root.value("msgID", 0);
+        header.requestID = ++nextRequestID;
+        header.length = body.size();
+        char buf[WIRE_HEADER_SIZE];
+        encodeFrameHeader(header, buf);
+        sendm(buf, sizeof(buf));             // 发送帧头
+        sendm(body.data(), body.size());     // 发送报文体
+        return;
+    }
 
+    string msg = root.dump(4);
 #ifdef __DEBUG__
     printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
     cout << msg << endl;
@@ -214,20 +262,166 @@ void sendQuery(string &query)
     sendm(msg.c_str(), length);     // 发送车厢
 }
 
-void recvKeys()
+/**
+ *  接收一条响应（按前 4 字节区分二进制协议与小火车协议）
+ */
+Json recvJson()
 {
+    char head[WIRE_HEADER_SIZE] = {0};
+    recvm(head, sizeof(uint32_t));
+    if (loadU32(head) == WIRE_MAGIC)
+    {
+        recvm(head + sizeof(uint32_t), WIRE_HEADER_SIZE - sizeof(uint32_t)); // 接收帧头的其余部分
+        FrameHeader header = decodeFrameHeader(head);
+        string body(header.length, '\0');
+        recvm(&body[0], header.length); // 接收报文体
+        return fromWireResponse(body);
+    }
 
     size_t length = 0;
-    recvm(&length, sizeof(size_t)); // 接收车头
-    char buf[length + 1] = {0};
-    recvm(buf, length); // 接收车厢
+    ::memcpy(&length, head, sizeof(uint32_t)); // 接收车头
+    recvm((char *)&length + sizeof(uint32_t), sizeof(size_t) - sizeof(uint32_t));
+    string msg(length, '\0');
+    recvm(&msg[0], length); // 接收车厢
 
-    string msg(buf);
 #ifdef __DEBUG__
     printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
     cout << msg << endl;
 #endif
-    Json root = json::parse(msg); // 解析
+    return json::parse(msg); // 解析
+}
+
+/**
+ *  发送关键词
+ */
+void sendKey(string &key)
+{
+    Json root;
+    root["msgID"] = 1;
+    root["msg"] = key;
+    sendJson(root);
+}
+
+/**
+ *  发送前缀（请求前缀补全）
+ */
+void sendPrefix(string &prefix)
+{
+    Json root;
+    root["msgID"] = 5;
+    root["msg"] = prefix;
+    sendJson(root);
+}
+
+/**
+ *  发送查询词（请求第一页）
+ */
+void sendQuery(string &query)
+{
+    Json root;
+    root["msgID"] = 2;
+    root["msg"] = query;
+    root["offset"] = 0;
+    root["limit"] = pageSize;
+    sendJson(root);
+}
+
+/**
+ *  批量发送：关键词推荐 + 网页查询（一帧请求，一帧响应）
+ */
+void sendBatch(string &query)
+{
+    Json key;
+    key["msgID"] = 1;
+    key["msg"] = query;
+
+    Json search;
+    search["msgID"] = 2;
+    search["msg"] = query;
+    search["offset"] = 0;
+    search["limit"] = pageSize;
+
+    Json root;
+    root["msgID"] = 4;
+    root["msg"] = Json::array({key, search});
+    sendJson(root);
+}
+
+/**
+ *  请求从第 offset 篇开始的一页
+ *
+ *  1. 带上 query，若服务器上的 cursor 已过期，服务器会重新查询
+ */
+void sendPageRequest(const string &query, uint64_t cursor, size_t offset)
+{
+    Json root;
+    root["msgID"] = 3;
+    root["msg"] = query;
+    root["cursor"] = cursor;
+    root["offset"] = offset;
+    root["limit"] = pageSize;
+    sendJson(root);
+}
+
+/**
+ *  显示一页网页查询结果
+ */
+void showPage(Json &root)
+{
+    for (auto &page : root["msg"])
+    {
+        cout << "[Title] " << page["title"] << endl;
+        cout << "[url] " << page["url"] << endl;
+        cout << "[Summary] " << page["summary"] << endl
+             << endl;
+    }
+}
+
+/**
+ *  分页显示网页查询结果
+ *
+ *  1. 服务器每次只返回一页，翻页时凭 cursor 向服务器请求下一页
+ */
+void showWithPaging(Json &root, const string &query)
+{
+    size_t total = root["total"];
+    if (total <= 1)
+        cout << "[ " << total << " page were found ]" << endl;
+    else
+        cout << "[ " << total << " pages were found ]" << endl;
+    if (root.value("partial", false))
+        cout << "[ search timed out, results may be incomplete ]" << endl;
+
+    showPage(root);
+    size_t shown = (size_t)root["offset"] + root["msg"].size(); // 已显示的页面数
+
+    while (shown < total)
+    {
+        size_t restNum = total - shown; // 剩余页面数
+        if (restNum <= 1)
+            cout << "[ " << restNum << " page behind, please input 'n' to show the rest, or 'c' to continue ]" << endl;
+        else
+            cout << "[ " << restNum << " pages behind, please input 'n' to show the rest, or 'c' to continue ]" << endl;
+
+        char opt;
+        cin >> opt;
+        if (opt != 'n')
+            break;
+
+        sendPageRequest(query, root["cursor"], shown);
+        root = recvJson();
+        if (200 != root["msgID"] || root["msg"].empty())
+            break;
+
+        showPage(root);
+        total = root["total"];
+        shown = (size_t)root["offset"] + root["msg"].size();
+    }
+}
+
+void recvKeys()
+{
+    Json root = recvJson();
     if (100 == root["msgID"])
     {
         cout << "Response from server: " << endl;
@@ -249,23 +443,13 @@ void recvKeys()
     }
 }
 
-void recvWebPages()
+void recvWebPages(const string &query)
 {
-    size_t length = 0;
-    recvm(&length, sizeof(size_t)); // 接收车头
-    char buf[length + 1] = {0};
-    recvm(buf, length); // 接收车厢
-
-    string msg(buf);
-#ifdef __DEBUG__
-    printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-    cout << msg << endl;
-#endif
-    Json root = json::parse(msg); // 解析
+    Json root = recvJson();
     if (200 == root["msgID"])
     {
         cout << "Response from server: " << endl;
-        showWithPaging(root);
+        showWithPaging(root, query);
     }
     else if (404 == root["msgID"])
     {
@@ -280,6 +464,34 @@ void recvWebPages()
     }
 }
 
+void recvBatch(const string &query)
+{
+    Json root = recvJson();
+    if (300 != root["msgID"] || root["msg"].size() != 2)
+    {
+        cout << "Something Error! System close!" << endl;
+        close(netFd);
+        exit(EXIT_FAILURE);
+    }
+
+    cout << "Response from server: " << endl;
+    Json &keys = root["msg"][0];
+    if (100 == keys["msgID"])
+    {
+        for (auto &key : keys["msg"])
+            cout << key << endl;
+    }
+    else
+        cout << keys["msg"] << endl;
+    cout << endl;
+
+    Json &pages = root["msg"][1];
+    if (200 == pages["msgID"])
+        showWithPaging(pages, query);
+    else
+        cout << pages["msg"] << endl;
+}
+
 int main(int argc, char *argv[])
 {
     string ip = Configuration::getInstance()->getConfigMap()["ip"];
@@ -318,11 +530,23 @@ int main(int argc, char *argv[])
             cout << "Please input a query: " << endl;
             cin >> msg;
             sendQuery(msg);
-            recvWebPages();
+            recvWebPages(msg);
             break;
         case 3:
             close(netFd);
             exit(EXIT_SUCCESS);
+        case 4:
+            cout << "Please input a query: " << endl;
+            cin >> msg;
+            sendBatch(msg);
+            recvBatch(msg);
+            break;
+        case 5:
+            cout << "Please input a prefix: " << endl;
+            cin >> msg;
+            sendPrefix(msg);
+            recvKeys(); // 响应格式与关键词推荐相同
+            break;
         default:
             cout << "Error option! System close!" << endl;
             close(netFd);
@@ -1,10 +1,16 @@
 #include "DictProducer.h"
 #include "SplitTool.h"
 #include "Configuration.h"
+#include "DeletionIndex.h"
+#include "CompletionTrie.h"
+#include "MultiBytesCharacter.h"
 #include <ErrorCheck>
 #include <sys/types.h>
 #include <dirent.h>
 #include <string.h>
+#include <algorithm>
+#include <queue>
+#include <tuple>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -30,6 +36,12 @@ DictProducer::DictProducer(const string &dir)
     storeDict(enDictPath.c_str());
     buildIndex();
     storeIndex(enDictIndex.c_str());
+    string enDictDeletes = Configuration::getInstance()->get("enDictDeletes", ""); // 删除变体索引（可选）
+    if (!enDictDeletes.empty())
+        storeDeletes(enDictDeletes.c_str(), Configuration::getInstance()->getNumber("maxkeydist", 2));
+    string enDictCompletions = Configuration::getInstance()->get("enDictCompletions", ""); // 前缀补全 trie（可选）
+    if (!enDictCompletions.empty())
+        storeCompletions(enDictCompletions.c_str(), Configuration::getInstance()->getNumber("completionnum", 10));
     cout << "Build En Dict and DictIndex OK" << endl;
 } //英文
 
@@ -46,6 +58,12 @@ DictProducer::DictProducer(const string &dir, SplitTool *splitTool)
     storeDict(dictPath.c_str());
     buildIndex();
     storeIndex(dictIndex.c_str());
+    string dictDeletes = Configuration::getInstance()->get("dictDeletes", ""); // 删除变体索引（可选）
+    if (!dictDeletes.empty())
+        storeDeletes(dictDeletes.c_str(), Configuration::getInstance()->getNumber("maxkeydist", 2));
+    string dictCompletions = Configuration::getInstance()->get("dictCompletions", ""); // 前缀补全 trie（可选）
+    if (!dictCompletions.empty())
+        storeCompletions(dictCompletions.c_str(), Configuration::getInstance()->getNumber("completionnum", 10));
     cout << "Build Cn Dict and DictIndex OK" << endl;
 } //中文
 
@@ -152,7 +170,7 @@ void DictProducer::buildCnDict()
 
         delete buff;
 
-        vector<string> tmp = _splitTool->cut(txt);
+        vector<string> tmp = _splitTool->cut(foldCharacters(txt)); // 先规范化再分词，与查询时的顺序一致
 
         for (auto &elem : tmp)
         {
@@ -226,6 +244,163 @@ void DictProducer::storeIndex(const char *filepath)
     ofs.close();
 }
 
+/**
+ *  生成删除变体索引（格式见 DeletionIndex.h）
+ *
+ *  1. 词编号为该词在 storeDict 所写词典中的行号（与 buildIndex 相同的遍历顺序）
+ *  2. 哈希表槽位数取不小于变体数两倍的 2 的幂，保证线性探测总能遇到空槽
+ */
+void DictProducer::storeDeletes(const char *filepath, int maxDist)
+{
+    unordered_map<uint64_t, vector<uint32_t>> deletes; // <变体的哈希, 升序的词编号>
+    uint32_t id = 0;
+    for (auto &elem : _dict2)
+    {
+        for (uint64_t hash : deletionHashes(decodeUtf8(elem.first), maxDist))
+            deletes[hash].push_back(id);
+        ++id;
+    }
+
+    uint32_t slotBits = 4;
+    while (((size_t)1 << slotBits) < deletes.size() * 2)
+        ++slotBits;
+    vector<DeletionSlot> slots((size_t)1 << slotBits, DeletionSlot{0, 0, 0});
+    vector<uint32_t> ids;
+    const size_t mask = slots.size() - 1;
+    for (auto &entry : deletes)
+    {
+        size_t slot = entry.first & mask;
+        while (slots[slot].hash != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = DeletionSlot{entry.first, (uint32_t)ids.size(), (uint32_t)entry.second.size()};
+        ids.insert(ids.end(), entry.second.begin(), entry.second.end());
+    }
+
+    ofstream ofs(filepath, std::ios::binary);
+    if (!ofs.good())
+    {
+        cout << "error in store deletes" << endl;
+        return;
+    }
+    DeletionHeader header{DELETION_MAGIC, DELETION_VERSION, (uint32_t)maxDist, slotBits, ids.size()};
+    ofs.write((const char *)&header, sizeof(header));
+    ofs.write((const char *)slots.data(), slots.size() * sizeof(DeletionSlot));
+    ofs.write((const char *)ids.data(), ids.size() * sizeof(uint32_t));
+    ofs.close();
+    cout << "deletion index: " << deletes.size() << " variants, " << ids.size() << " ids" << endl;
+}
+
+/**
+ *  生成前缀补全 trie（格式见 CompletionTrie.h）
+ *
+ *  1. 词编号为该词在 storeDict 所写词典中的行号
+ *  2. 按词频降序（同频按字典序）依次插入，每个结点只收下最先到达的 topK 个词，
+ *     即为以该结点为前缀的词频最高的 topK 个词
+ *  3. 先建指针形式的 trie，再按层次遍历顺序为每个结点寻找不冲突的 base，
+ *     压缩为双数组
+ */
+void DictProducer::storeCompletions(const char *filepath, size_t topK)
+{
+    vector<std::tuple<int, const string *, uint32_t>> ranked; // <-词频, 词, 编号>
+    uint32_t id = 0;
+    for (auto &elem : _dict2)
+        ranked.emplace_back(-elem.second, &elem.first, id++);
+    std::sort(ranked.begin(), ranked.end(), [](const auto &lhs, const auto &rhs) {
+        if (std::get<0>(lhs) != std::get<0>(rhs))
+            return std::get<0>(lhs) < std::get<0>(rhs);
+        return *std::get<1>(lhs) < *std::get<1>(rhs);
+    });
+
+    struct TrieNode
+    {
+        map<unsigned char, uint32_t> children;
+        vector<uint32_t> tops;
+    };
+    vector<TrieNode> nodes(1); // nodes[0] 为根结点（空前缀）
+    for (auto &word : ranked)
+    {
+        uint32_t cur = 0;
+        if (nodes[cur].tops.size() < topK)
+            nodes[cur].tops.push_back(std::get<2>(word));
+        for (unsigned char ch : *std::get<1>(word))
+        {
+            auto it = nodes[cur].children.find(ch);
+            if (it == nodes[cur].children.end())
+            {
+                nodes.emplace_back();
+                it = nodes[cur].children.insert({ch, nodes.size() - 1}).first;
+            }
+            cur = it->second;
+            if (nodes[cur].tops.size() < topK)
+                nodes[cur].tops.push_back(std::get<2>(word));
+        }
+    }
+
+    vector<CompletionUnit> units(1, CompletionUnit{0, 0, 0, 0}); // 根结点占用单元 0
+    vector<uint32_t> tops;
+    vector<int32_t> unitOf(nodes.size(), 0); // trie 结点所在的单元
+    std::queue<uint32_t> que;
+    que.push(0);
+    size_t nextFree = 1; // 第一个可能空闲的单元
+    while (!que.empty())
+    {
+        uint32_t node = que.front();
+        que.pop();
+        int32_t state = unitOf[node];
+        units[state].topBegin = tops.size();
+        units[state].topCount = nodes[node].tops.size();
+        tops.insert(tops.end(), nodes[node].tops.begin(), nodes[node].tops.end());
+
+        auto &children = nodes[node].children;
+        if (children.empty())
+            continue;
+
+        int32_t base = std::max<int32_t>(1, (int32_t)nextFree - children.begin()->first - 1);
+        for (;; ++base) // 寻找所有子结点单元都空闲的 base
+        {
+            bool fit = true;
+            for (auto &child : children)
+            {
+                size_t pos = base + child.first + 1;
+                if (pos < units.size() && units[pos].check != -1)
+                {
+                    fit = false;
+                    break;
+                }
+            }
+            if (fit)
+                break;
+        }
+
+        units[state].base = base;
+        size_t last = base + children.rbegin()->first + 1;
+        if (last >= units.size())
+            units.resize(last + 1, CompletionUnit{0, -1, 0, 0});
+        for (auto &child : children)
+        {
+            int32_t pos = base + child.first + 1;
+            units[pos].check = state;
+            unitOf[child.second] = pos;
+            que.push(child.second);
+        }
+        while (nextFree < units.size() && units[nextFree].check != -1)
+            ++nextFree;
+    }
+
+    ofstream ofs(filepath, std::ios::binary);
+    if (!ofs.good())
+    {
+        cout << "error in store completions" << endl;
+        return;
+    }
+    CompletionHeader header{COMPLETION_MAGIC, COMPLETION_VERSION, (uint32_t)units.size(), (uint32_t)topK, tops.size()};
+    ofs.write((const char *)&header, sizeof(header));
+    ofs.write((const char *)units.data(), units.size() * sizeof(CompletionUnit));
+    ofs.write((const char *)tops.data(), tops.size() * sizeof(uint32_t));
+    ofs.close();
+    cout << "completion trie: " << nodes.size() << " nodes, " << units.size() << " units" << endl;
+}
+
 void DictProducer::showFiles() const
 {
     for (auto &elem : _files)
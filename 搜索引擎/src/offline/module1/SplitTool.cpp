@@ -16,4 +16,11 @@ vector<string> SplitTool::cut(const string &sentence)
     _jieba.CutForSearch(sentence, result);
     return result;
 }
+
+vector<Word> SplitTool::cutWithOffset(const string &sentence)
+{
+    vector<Word> result;
+    _jieba.CutForSearch(sentence, result);
+    return result;
+}
 }; // namespace wdcpp
@@ -9,11 +9,14 @@ namespace wdcpp
  *  1. 输入 page 的引用
  *  2. 求得 page 的 hash 值
  *  3. 判断是否需要剔除该网页
+ *  4. self 返回 page 的 hash 值；matched 返回与 page 重复的 hash 值（剔除时）或 self（保留时），
+ *     供调用者统计重复簇的大小
  */
-bool CompareSimhash::cut(const WebPage &page)
+bool CompareSimhash::cut(const WebPage &page, uint64_t &self, uint64_t &matched)
 {
     uint64_t i = 0;
     _simhasher.make(page.getContent(), topN, i); // 求 page 的 64 位 hash 值
+    self = matched = i;
 
     uint64_t a = 0xff000000;
     uint64_t b = 0x00ff0000;
@@ -28,6 +31,7 @@ bool CompareSimhash::cut(const WebPage &page)
             {
                 if (Simhasher::isEqual(i, hash))
                 {
+                    matched = hash;
                     return true;
                 }
             }
@@ -39,6 +43,7 @@ bool CompareSimhash::cut(const WebPage &page)
             {
                 if (Simhasher::isEqual(i, hash))
                 {
+                    matched = hash;
                     return true;
                 }
             }
@@ -50,6 +55,7 @@ bool CompareSimhash::cut(const WebPage &page)
             {
                 if (Simhasher::isEqual(i, hash))
                 {
+                    matched = hash;
                     return true;
                 }
             }
@@ -61,6 +67,7 @@ bool CompareSimhash::cut(const WebPage &page)
             {
                 if (Simhasher::isEqual(i, hash))
                 {
+                    matched = hash;
                     return true;
                 }
             }
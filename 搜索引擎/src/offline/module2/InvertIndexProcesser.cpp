@@ -1,16 +1,24 @@
 #include "InvertIndexProcesser.h"
 #include "WebPage.h"
+#include "VarInt.h"
+#include "PositionIndex.h"
+#include "MultiBytesCharacter.h"
 #include "math.h"
 
 #include <ErrorCheck>
 #include <iostream>
+#include <algorithm>
 
 namespace wdcpp
 {
 InvertIndexProcesser::InvertIndexProcesser(vector<WebPage> &pageList,
-                                           unordered_map<string, unordered_map<PageID, double>> &invertIndexTable)
+                                           unordered_map<string, unordered_map<PageID, Posting>> &invertIndexTable,
+                                           unordered_map<string, unordered_map<PageID, EncodedPositions>> &positionTable,
+                                           vector<size_t> &docLengths)
     : _pageList(pageList),
-      _invertIndexTable(invertIndexTable)
+      _invertIndexTable(invertIndexTable),
+      _positionTable(positionTable),
+      _docLengths(docLengths)
 {
 }
 
@@ -24,12 +32,15 @@ void InvertIndexProcesser::process()
     // cout << "_pageList.size() = " << _pageList.size() << endl;
 
     _sumOfWeightsPerPage.resize(_pageList.size(), 0.0); // 为 _sumOfWeightsPerPage 申请内存并初始化
+    _docLengths.resize(_pageList.size(), 0);
 
     for (auto &page : _pageList) // WebPage page
     {
         auto &wordsMap = page.getWordsMap(); // unordered_map<string, int> wordsMap
         for (auto &wordPair : wordsMap)      // pair<string, int> wordPair
         {
+            _docLengths[page.getDocId()] += wordPair.second;
+
             string word = wordPair.first;
 
             int wordNumInPage = wordsMap.size(); // page 网页中的单词总数
@@ -40,21 +51,21 @@ void InvertIndexProcesser::process()
             }
             double TF = (double)wordPair.second / wordNumInPage;
 
-            _invertIndexTable[word].insert({page.getDocId(), TF}); // value = TF
+            _invertIndexTable[word].insert({page.getDocId(), {TF, wordPair.second}}); // weight = TF
         }
     }
 
     // cout << "_invertIndexTable.size() = " << _invertIndexTable.size() << endl;
 
     // 遍历所有单词 word
-    for (auto &invertIndexPair : _invertIndexTable) // pair<string, unordered_map<int, double>> invertIndexPair
+    for (auto &invertIndexPair : _invertIndexTable) // pair<string, unordered_map<PageID, Posting>> invertIndexPair
     {
         // 遍历 word 所在的所有文章 pageId
-        auto &pageIdMap = invertIndexPair.second; // unordered_map<int, double> pageIdMap
-        for (auto &pageIdPair : pageIdMap)        // pair<int, double> pageIdPair
+        auto &pageIdMap = invertIndexPair.second; // unordered_map<PageID, Posting> pageIdMap
+        for (auto &pageIdPair : pageIdMap)        // pair<PageID, Posting> pageIdPair
         {
             int pageId = pageIdPair.first;
-            double TF = pageIdPair.second;//每个单词在当前ID所在的文章中出现的频率
+            double TF = pageIdPair.second.weight;//每个单词在当前ID所在的文章中出现的频率
             int DF = pageIdMap.size(); // 上限 -> N  每个单词出现在多少个文章中  
             int N = _pageList.size();//所有文章的个数
             double IDF = 0.0;
@@ -62,17 +73,17 @@ void InvertIndexProcesser::process()
                 IDF = (double)log10((double)N / (DF + 1));
             double w = TF * IDF;
 
-            pageIdPair.second = w; // value = w
+            pageIdPair.second.weight = w; // weight = w
             // cout << "_sumOfWeightsPerPage.size() = " << _sumOfWeightsPerPage.size() << endl;
             // cout << "pageId = " << pageId << endl;
             _sumOfWeightsPerPage[pageId] += w * w;
         }
     }
 
-    for (auto &invertIndexPair : _invertIndexTable) // pair<string, set<pair<int, double>>> invertIndexPair
+    for (auto &invertIndexPair : _invertIndexTable) // pair<string, unordered_map<PageID, Posting>> invertIndexPair
     {
-        auto &pageIdMap = invertIndexPair.second; // map<int, double> pageIdMap
-        for (auto &pageIdPair : pageIdMap)        // pair<int, double> pageIdPair
+        auto &pageIdMap = invertIndexPair.second; // unordered_map<PageID, Posting> pageIdMap
+        for (auto &pageIdPair : pageIdMap)        // pair<PageID, Posting> pageIdPair
         {
             int pageId = pageIdPair.first;
             double sumWeight = _sumOfWeightsPerPage[pageId];
@@ -81,15 +92,49 @@ void InvertIndexProcesser::process()
                 ERROR_PRINT("this page's sumWeight equal 0.0\n");
                 exit(EXIT_FAILURE);
             }
-            pageIdPair.second /= sqrt(sumWeight); // value = w'
+            pageIdPair.second.weight /= sqrt(sumWeight); // weight = w'
         }
     }
 
+    buildPositionTable(); // 生成位置索引
+
     // cout << "end InvertIndexProcesser::process()" << endl;
 
     // printInvertIndexTable();
 }
 
+/**
+ *  生成位置索引
+ *
+ *  1. 每个 <word, docid> 的位置列表升序去重后，按 "个数 + 差值序列" 做变长整数编码
+ *  2. content 中的第一个位置映射回原文的字节偏移，作为摘要锚点（在线部分无需再扫描原文）
+ *  3. 编码后即释放网页中的原始位置列表
+ */
+void InvertIndexProcesser::buildPositionTable()
+{
+    for (auto &page : _pageList)
+    {
+        auto &wordPositions = page.getWordPositions(); // unordered_map<string, vector<uint32_t>> wordPositions
+        if (wordPositions.empty())
+            continue;
+        vector<uint32_t> rawOffsets = unfoldTable(page.getContent()); // 规范化后 content 的每个字节在原文中的偏移
+        for (auto &positionPair : wordPositions)                      // pair<string, vector<uint32_t>> positionPair
+        {
+            auto &positions = positionPair.second;
+            std::sort(positions.begin(), positions.end());
+            positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+            EncodedPositions encoded{string(), NO_ANCHOR};
+            encodePositions(encoded.data, positions);
+            auto it = std::lower_bound(positions.begin(), positions.end(), CONTENT_POSITION_BASE);
+            if (it != positions.end() && *it - CONTENT_POSITION_BASE < rawOffsets.size())
+                encoded.anchor = rawOffsets[*it - CONTENT_POSITION_BASE];
+            _positionTable[positionPair.first].insert({page.getDocId(), std::move(encoded)});
+        }
+        unordered_map<string, vector<uint32_t>>().swap(wordPositions);
+    }
+}
+
 void InvertIndexProcesser::printInvertIndexTable()
 {
     using namespace std;
@@ -99,7 +144,7 @@ void InvertIndexProcesser::printInvertIndexTable()
         cout << wordPair.first << " ";
         for (auto &pagePair : wordPair.second)
         {
-            cout << "<" << pagePair.first << ", " << pagePair.second << "> ";
+            cout << "<" << pagePair.first << ", " << pagePair.second.weight << ", " << pagePair.second.freq << "> ";
         }
         cout << endl;
     }
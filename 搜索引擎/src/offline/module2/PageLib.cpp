@@ -1,6 +1,8 @@
 #include "PageLib.h"
 #include "Configuration.h"
+#include "PositionIndex.h"
 
+#include <algorithm>
 #include <fstream>
 //#include <ErrorCheck>
 using std::ofstream;
@@ -10,7 +12,7 @@ namespace wdcpp
 PageLib::PageLib(const string &dirPath)
     : _dirScanner(dirPath),
       _pageProcesser(_dirScanner.getFilePathList(), _pageList),
-      _invertIndexProcesser(_pageList, _invertIndexTable),
+      _invertIndexProcesser(_pageList, _invertIndexTable, _positionTable, _docLengths),
       _offsetProcesser(_pageList, _offsetTable)
 {
 }
@@ -48,7 +50,7 @@ void PageLib::store()
     }
     ofs1.close();
 
-    // 写倒排索引库
+    // 写倒排索引库（每行为 "word docid w' freq docid w' freq ..."）
     ofstream ofs2(InvertIndex);
     if (!ofs2)
     {
@@ -61,13 +63,14 @@ void PageLib::store()
         for (auto &pagePair : wordPair.second)
         {
             ofs2 << pagePair.first << " "
-                 << pagePair.second << " ";
+                 << pagePair.second.weight << " "
+                 << pagePair.second.freq << " ";
         }
         ofs2 << "\n";
     }
     ofs2.close();
 
-    // 写偏移库
+    // 写偏移库（每行为 "docid beg len staticRank"）
     ofstream ofs3(offsetPath);
     if (!ofs3)
     {
@@ -79,10 +82,88 @@ void PageLib::store()
         ofs3 << _pageList[idx].getDocId() << " "
              << _offsetTable[idx].first << " "
              << _offsetTable[idx].second << " "
+             << _pageList[idx].getStaticRank() << " " // 静态排名（docid 越小越高）
              << "\n";
     }
     ofs3.close();
 
+    // 写位置索引（仅当配置了 positions 时生成）
+    // positions.dat 为所有编码后位置列表的拼接（二进制），
+    // positionsIndex.dat 为按单词、docid 排好序的偏移表（格式见 PositionIndex.h），在线部分直接 mmap
+    string positionsPath = Configuration::getInstance()->get("positions", "");
+    string positionsIndexPath = Configuration::getInstance()->get("positionsIndex", "");
+    if (!positionsPath.empty() && !positionsIndexPath.empty())
+    {
+        ofstream ofs4(positionsPath, std::ios::binary);
+        ofstream ofs5(positionsIndexPath, std::ios::binary);
+        if (!ofs4 || !ofs5)
+        {
+            std::cout << "can not open positions.dat" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        vector<const string *> words; // 按字节序排序的单词（与在线部分的二分查找一致）
+        words.reserve(_positionTable.size());
+        for (auto &wordPair : _positionTable)
+            words.push_back(&wordPair.first);
+        std::sort(words.begin(), words.end(), [](const string *lhs, const string *rhs) {
+            return string_view(*lhs) < string_view(*rhs);
+        });
+
+        vector<PositionWord> wordTable;
+        vector<PositionEntry> entries;
+        string names;
+        uint64_t offset = 0;
+        for (const string *word : words)
+        {
+            auto &pages = _positionTable[*word];
+            vector<PageID> docids;
+            docids.reserve(pages.size());
+            for (auto &pagePair : pages)
+                docids.push_back(pagePair.first);
+            std::sort(docids.begin(), docids.end());
+
+            wordTable.push_back(PositionWord{names.size(), (uint32_t)word->size(), (uint32_t)docids.size(), entries.size()});
+            names += *word;
+            for (PageID docid : docids)
+            {
+                const EncodedPositions &encoded = pages[docid];
+                ofs4.write(encoded.data.data(), encoded.data.size());
+                entries.push_back(PositionEntry{docid, offset, encoded.anchor, 0});
+                offset += encoded.data.size();
+            }
+        }
+        PositionHeader header{POSITION_MAGIC, POSITION_VERSION, wordTable.size(), entries.size(), names.size()};
+        ofs5.write((const char *)&header, sizeof(header));
+        ofs5.write((const char *)wordTable.data(), wordTable.size() * sizeof(PositionWord));
+        ofs5.write((const char *)entries.data(), entries.size() * sizeof(PositionEntry));
+        ofs5.write(names.data(), names.size());
+        ofs4.close();
+        ofs5.close();
+    }
+
+    // 写文章统计信息（BM25 打分使用，仅当配置了 docStats 时生成）
+    // 第一行为 "文章总数 平均文章长度"，其后每行为 "docid length"（词频在倒排索引中）
+    string docStatsPath = Configuration::getInstance()->get("docStats", "");
+    if (!docStatsPath.empty())
+    {
+        ofstream ofs6(docStatsPath);
+        if (!ofs6)
+        {
+            std::cout << "can not open docStats.dat" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        size_t totalLength = 0;
+        for (auto length : _docLengths)
+            totalLength += length;
+        ofs6 << _pageList.size() << " "
+             << (_pageList.empty() ? 0.0 : (double)totalLength / _pageList.size()) << "\n";
+        for (auto &page : _pageList)
+        {
+            ofs6 << page.getDocId() << " " << _docLengths[page.getDocId()] << "\n";
+        }
+        ofs6.close();
+    }
+
     cout << "store succeed!" << endl;
 }
 }; // namespace wdcpp
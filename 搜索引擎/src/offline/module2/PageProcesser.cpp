@@ -2,9 +2,11 @@
 #include "WebPage.h"
 #include "RssParser.h"
 #include "Configuration.h"
+#include "MultiBytesCharacter.h"
 
 #include <sys/time.h>
 #include <ErrorCheck>
+#include <math.h>
 #include <algorithm>
 #include <fstream>
 using std::ifstream;
@@ -14,11 +16,18 @@ namespace wdcpp
 {
 PageProcesser::PageProcesser(vector<string> &filePathList, vector<WebPage> &pageList)
     : _filePathList(filePathList),
-      _nonRepetivepageList(pageList)
+      _nonRepetivepageList(pageList),
+      _withPositions(!Configuration::getInstance()->get("positions", "").empty())
 {
     loadStopWords();
+    loadSourceWeights();
 }
 
+/**
+ *  读入停用词库
+ *
+ *  1. 每个停用词先做字符规范化，与分词结果（WebPage::splitWord 中已规范化）比较时规则一致
+ */
 void PageProcesser::loadStopWords()
 {
     ifstream ifs(Configuration::getInstance()->getConfigMap()["stopwords"]);
@@ -28,7 +37,33 @@ void PageProcesser::loadStopWords()
     }
     string word;
     while (ifs >> word)
-        _stopWords.push_back(word);
+    {
+        string folded = foldCharacters(word);
+        if (!folded.empty())
+            _stopWords.push_back(std::move(folded));
+    }
+}
+
+/**
+ *  读入各 RSS 来源的权重（可选）
+ *
+ *  1. 配置项 sourceWeights 指向的文件每行为 "RSS文件名 权重"，权重范围 [0, 1]
+ */
+void PageProcesser::loadSourceWeights()
+{
+    string sourceWeightsPath = Configuration::getInstance()->get("sourceWeights", "");
+    if (sourceWeightsPath.empty())
+        return;
+    ifstream ifs(sourceWeightsPath);
+    if (!ifs)
+    {
+        ERROR_PRINT("can not open %s", sourceWeightsPath.c_str());
+        return;
+    }
+    string source;
+    double weight;
+    while (ifs >> source >> weight)
+        _sourceWeights[source] = weight;
 }
 
 /**
@@ -36,7 +71,8 @@ void PageProcesser::loadStopWords()
  *
  *  1. 将网页文件交给 RssPraser 解析，生成未去重的 _pageList 对象
  *  2. 使用 simhash 进行网页去重，得到去重后的 _nonRepetivepageList 对象
- *  3. 对 _nonRepetivepageList 对象中每篇文章进行词频统计
+ *  3. 计算静态排名，按静态排名从高到低分配 docid
+ *  4. 对 _nonRepetivepageList 对象中每篇文章进行词频统计
  */
 void PageProcesser::process()
 {
@@ -57,6 +93,8 @@ void PageProcesser::process()
         printf("cutRedundantPage take total %ld microsecends\n",
                (endTime.tv_sec - begTime.tv_sec) * 1000000 + (endTime.tv_usec - begTime.tv_usec));
 
+        computeStaticRank(); // 按静态排名从高到低排列
+
         // 去重结束，可以确定每篇文章的 _docID 与 _doc
         for (size_t idx = 0; idx < _nonRepetivepageList.size(); ++idx)
         {
@@ -92,6 +130,7 @@ void PageProcesser::loadPageFromXML()
         {
             WebPage page(item);
             page.setPageID(ID++); // 更新 ID 便于去重时排序
+            page.setFeedSource(filePath.substr(filePath.find_last_of('/') + 1));
             _pageList.push_back(std::move(page));
             // _pageList.push_back(str); // 存在隐式转换
         }
@@ -113,10 +152,24 @@ void PageProcesser::cutRedundantPage()
 {
     sort(_pageList.begin(), _pageList.end(), cmp); // 将所有文章按 cmp 排序
 
+    unordered_map<uint64_t, size_t> clusters; // <hash, 所属重复簇的网页在 _nonRepetivepageList 中的下标>
     for (auto &page : _pageList)
     {
-        if (!_comparePages.cut(page)) // 若无需剔除 page 则将其保存到 _nonRepetivepageList 中
+        uint64_t self = 0, matched = 0;
+        if (!_comparePages.cut(page, self, matched)) // 若无需剔除 page 则将其保存到 _nonRepetivepageList 中
+        {
+            clusters[self] = _nonRepetivepageList.size();
             _nonRepetivepageList.push_back(page);
+        }
+        else
+        {
+            auto it = clusters.find(matched); // 被剔除的网页计入与之重复的网页所在的簇
+            if (it != clusters.end())
+            {
+                _nonRepetivepageList[it->second].addDuplicate();
+                clusters.insert({self, it->second});
+            }
+        }
     }
 
     // using namespace std;
@@ -150,13 +203,52 @@ void PageProcesser::cutRedundantPage()
     // cout << "size = " << _nonRepetivepageList.size() << endl;
 }
 
+/**
+ *  计算每篇网页与查询无关的静态排名，并按静态排名从高到低排列网页
+ *
+ *  1. staticRank = 0.4 * 长度得分 + 0.3 * 重复簇得分 + 0.3 * 来源得分，范围 [0, 1]
+ *     长度得分：log(1 + content 字节数)，按最大值归一化
+ *     重复簇得分：log(1 + 重复簇大小)，按最大值归一化（被多处转载的网页更重要）
+ *     来源得分：sourceWeights 中该 RSS 文件的权重，未配置的来源取 0.5
+ *  2. 排序后 docid 越小静态排名越高，在线部分据此提前结束打分
+ */
+bool staticRankCmp(const WebPage &lhs, const WebPage &rhs)
+{
+    return lhs.getStaticRank() > rhs.getStaticRank();
+}
+void PageProcesser::computeStaticRank()
+{
+    const double LENGTH_WEIGHT = 0.4;
+    const double DUPLICATE_WEIGHT = 0.3;
+    const double SOURCE_WEIGHT = 0.3;
+    const double DEFAULT_SOURCE_WEIGHT = 0.5;
+
+    size_t maxLength = 1, maxDuplicate = 1;
+    for (auto &page : _nonRepetivepageList)
+    {
+        maxLength = std::max(maxLength, page.getContent().size());
+        maxDuplicate = std::max(maxDuplicate, page.getDuplicateNum());
+    }
+
+    for (auto &page : _nonRepetivepageList)
+    {
+        double lengthScore = log(1.0 + page.getContent().size()) / log(1.0 + maxLength);
+        double duplicateScore = log(1.0 + page.getDuplicateNum()) / log(1.0 + maxDuplicate);
+        auto it = _sourceWeights.find(page.getFeedSource());
+        double sourceScore = it != _sourceWeights.end() ? it->second : DEFAULT_SOURCE_WEIGHT;
+        page.setStaticRank(LENGTH_WEIGHT * lengthScore + DUPLICATE_WEIGHT * duplicateScore + SOURCE_WEIGHT * sourceScore);
+    }
+
+    std::stable_sort(_nonRepetivepageList.begin(), _nonRepetivepageList.end(), staticRankCmp);
+}
+
 /**
  *  对每篇文章进行分词并统计词频
  */
 void PageProcesser::countFrequence()
 {
     for (auto &page : _nonRepetivepageList)
-        page.splitWord(_splitTool, _stopWords);
+        page.splitWord(_splitTool, _stopWords, _withPositions);
 }
 
 void PageProcesser::printPageList()
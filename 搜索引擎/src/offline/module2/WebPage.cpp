@@ -1,6 +1,8 @@
 #include "WebPage.h"
 #include "RssParser.h"
 #include "SplitTool.h"
+#include "MultiBytesCharacter.h"
+#include "VarInt.h"
 
 #include <sstream>
 using std::stringstream;
@@ -67,7 +69,7 @@ WebPage::WebPage()
 {
 }
 
-string WebPage::getDoc() const
+const string &WebPage::getDoc() const
 {
     return _doc;
 }
@@ -77,31 +79,51 @@ PageID WebPage::getDocId() const
     return _docID;
 }
 
-string WebPage::getTitle() const
+const string &WebPage::getTitle() const
 {
     return _docTitle;
 }
 
-string WebPage::getUrl() const
+const string &WebPage::getUrl() const
 {
     return _docURL;
 }
 
-string WebPage::getContent() const
+const string &WebPage::getContent() const
 {
     return _docContent;
 }
 
-string WebPage::getSummary() const
+const string &WebPage::getSummary() const
 {
     return _docSummary;
 }
 
+const string &WebPage::getFeedSource() const
+{
+    return _feedSource;
+}
+
+size_t WebPage::getDuplicateNum() const
+{
+    return _duplicateNum;
+}
+
+double WebPage::getStaticRank() const
+{
+    return _staticRank;
+}
+
 unordered_map<string, int> &WebPage::getWordsMap()
 {
     return _wordsMap;
 }
 
+unordered_map<string, vector<uint32_t>> &WebPage::getWordPositions()
+{
+    return _wordPositions;
+}
+
 void WebPage::setPageID(PageID ID)
 {
     _docID = ID;
@@ -126,17 +148,46 @@ void WebPage::setPageSummary(const string &summary)
     _docSummary = summary;
 }
 
+void WebPage::setFeedSource(const string &feedSource)
+{
+    _feedSource = feedSource;
+}
+
+void WebPage::addDuplicate()
+{
+    ++_duplicateNum;
+}
+
+void WebPage::setStaticRank(double staticRank)
+{
+    _staticRank = staticRank;
+}
+
 /**
  *  对 _docTitle 和 _docContent 分词并统计词频
+ *
+ *  1. title 与 content 分别先做字符规范化（全角转半角、大写转小写）再分词，每个词再规范化一次
+ *     （去掉空白），与查询时（QueryNormalizer）的顺序一致，两边的分词结果才相同
+ *  2. withPositions 为 true 时，同时记录每个词的位置（位置索引用）：规范化后文本中的字节偏移，
+ *     content 中的位置加上 CONTENT_POSITION_BASE（见 VarInt.h）
  */
-void WebPage::splitWord(SplitTool &tool, const vector<string> &stopWords)
-{
-    auto words = tool.cut(_docTitle + _docContent); // 分词
-    for (auto &word : words)                        // 去重并统计词频
-    {
-        if (word != " " && find(stopWords.begin(), stopWords.end(), word) == stopWords.end()) // 若不是停用词就加入 _wordsMap
-            ++_wordsMap[word];
-    }
+void WebPage::splitWord(SplitTool &tool, const vector<string> &stopWords, bool withPositions)
+{
+    auto splitPart = [&](const string &part, uint32_t base) {
+        string text = foldCharacters(part);
+        auto words = tool.cutWithOffset(text); // 分词
+        for (auto &word : words)               // 去重并统计词频
+        {
+            string folded = foldCharacters(word.word);
+            if (folded.empty() || find(stopWords.begin(), stopWords.end(), folded) != stopWords.end()) // 跳过停用词
+                continue;
+            ++_wordsMap[folded];
+            if (withPositions)
+                _wordPositions[folded].push_back(base + word.offset);
+        }
+    };
+    splitPart(_docTitle, 0);
+    splitPart(_docContent, CONTENT_POSITION_BASE);
 
     // printWordsMap();
 }
@@ -0,0 +1,117 @@
+#include "AsyncRedis.h"
+#include "MutexLockGuard.h"
+#include "MyLog.h"
+
+namespace wdcpp
+{
+AsyncRedis::AsyncRedis(const string &uri)
+    : _redis(uri),
+      _pending(_mutex),
+      _isExiting(false),
+      _thread(std::bind(&AsyncRedis::loop, this))
+{
+}
+
+AsyncRedis::~AsyncRedis()
+{
+    stop();
+}
+
+void AsyncRedis::start()
+{
+    _thread.create();
+}
+
+/**
+ *  处理完已入队的请求后退出 redis 线程
+ */
+void AsyncRedis::stop()
+{
+    {
+        MutexLockGuard autolock(_mutex);
+        if (_isExiting)
+            return;
+        _isExiting = true;
+    }
+    _pending.notify();
+    _thread.join();
+}
+
+/**
+ *  查询 key（与同一批次的其他 GET 一起发出），放入队列即返回
+ *
+ *  1. 结果返回后由 redis 线程调用 cb（未命中或 redis 出错时结果为空）
+ *  2. 已停止时返回 false，不调用 cb
+ */
+bool AsyncRedis::get(const string &key, GetCallBack &&cb)
+{
+    MutexLockGuard autolock(_mutex);
+    if (_isExiting)
+        return false;
+    _gets.push_back({key, std::move(cb), sw::redis::OptionalString()});
+    _pending.notify();
+    return true;
+}
+
+/**
+ *  写入 key，放入队列即返回
+ */
+void AsyncRedis::setex(const string &key, long long ttl, const string &value)
+{
+    MutexLockGuard autolock(_mutex);
+    if (_isExiting || _sets.size() >= MAX_PENDING_SETS)
+        return;
+    _sets.push_back({key, ttl, value});
+    _pending.notify();
+}
+
+/**
+ *  redis 线程：每次取出全部待发请求，一起执行，再依次调用 GET 的回调（锁外）
+ */
+void AsyncRedis::loop()
+{
+    vector<GetRequest> gets;
+    vector<SetRequest> sets;
+    while (true)
+    {
+        {
+            MutexLockGuard autolock(_mutex);
+            while (!_isExiting && _gets.empty() && _sets.empty())
+                _pending.wait();
+            if (_gets.empty() && _sets.empty()) // 正在退出，且已没有待发请求
+                break;
+            gets.swap(_gets);
+            sets.swap(_sets);
+        }
+
+        execute(gets, sets);
+
+        for (auto &request : gets)
+            request.cb(request.result);
+        gets.clear();
+        sets.clear();
+    }
+}
+
+/**
+ *  用一个 pipeline 发出一批请求（GET 在前，SETEX 在后）
+ */
+void AsyncRedis::execute(vector<GetRequest> &gets, vector<SetRequest> &sets)
+{
+    try
+    {
+        auto pipe = _redis.pipeline(false); // 使用连接池中的连接，不新建连接
+        for (auto &request : gets)
+            pipe.get(request.key);
+        for (auto &request : sets)
+            pipe.setex(request.key, request.ttl, request.value);
+        auto replies = pipe.exec();
+        for (size_t idx = 0; idx < gets.size(); ++idx)
+            gets[idx].result = replies.get<sw::redis::OptionalString>(idx);
+    }
+    catch (const sw::redis::Error &e)
+    {
+        LogError("redis pipeline failed: %s", e.what());
+    }
+}
+}; // namespace wdcpp
@@ -2,35 +2,25 @@
 
 namespace wdcpp
 {
-CacheGroup::CacheGroup(size_t capacity)
-    : _mainCache(capacity),
-      _pendingUpdateCache(capacity),
-      _onlyRead(false)
+CacheGroup::CacheGroup(size_t id, size_t capacity, size_t logCapacity, const CacheOptions &options)
+    : _mainCache(capacity, options),
+      _log(logCapacity),
+      _id(id),
+      _appliedEpoch(0),
+      _dropped(0),
+      _copyRequested(false)
 {
 }
 
-string CacheGroup::getRecord(const string &query)
+LRUCache::Value CacheGroup::getRecord(const string &query)
 {
     return _mainCache.getRecord(query);
 }
 
-void CacheGroup::insertRecord(const string &query, const string &result)
+void CacheGroup::insertRecord(const string &query, const LRUCache::Value &result, uint32_t cost)
 {
-    _mainCache.insertRecord(query, result);
-    if (!_onlyRead) // 若可写
-        _pendingUpdateCache.insertRecord(query, result);
-}
-
-// void CacheGroup::load(const string &path)
-// {
-// }
-// void CacheGroup::dump(const string &path)
-// {
-// }
-
-void CacheGroup::update(const CacheGroup &group)
-{
-    _mainCache.update(group._mainCache);
-    _pendingUpdateCache.update(group._pendingUpdateCache); // 传进来的 group 的 _pendingUpdateCache 是空的
+    _mainCache.insertRecord(query, result, cost);
+    if (!_log.push({query, result, cost, _id})) // 日志满：记下丢失，之后以全量副本补上
+        _dropped.fetch_add(1, std::memory_order_relaxed);
 }
 }; // namespace wdcpp
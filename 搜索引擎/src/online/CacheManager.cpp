@@ -1,10 +1,27 @@
 #include "CacheManager.h"
 #include "Configuration.h"
+#include "MutexLockGuard.h"
+#include "MyLog.h"
+#include "Protocol.h"
 
+#include <stdio.h>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+using std::ifstream;
+using std::ofstream;
+using std::unordered_map;
 
 namespace wdcpp
 {
+extern __thread size_t __thread_id; // 工作线程的编号（0, 1, 2, ... , _workerNum-1）
+
+const uint32_t SNAPSHOT_MAGIC = 0x53534457; // "WDSS"
+const uint32_t SNAPSHOT_VERSION = 2; // 2：记录中不再含游标，版本 1 的快照作废
+const size_t SNAPSHOT_ORIGIN = SIZE_MAX; // 快照中读入的记录不属于任何工作线程
+
 CacheManager *CacheManager::_pInstance = CacheManager::getInstance(); // 懒汉
 
 CacheManager *CacheManager::getInstance()
@@ -19,19 +36,52 @@ CacheManager *CacheManager::getInstance()
 
 CacheGroup &CacheManager::getCacheGroup(size_t idx)
 {
-    return _caches[idx];
+    return *_caches[idx];
 }
 
 CacheManager::CacheManager()
-    : _cacheNums(stoul(Configuration::getInstance()->getConfigMap()["workernum"])),
+    : _mode(parseMode()),
+      _cacheNums(stoul(Configuration::getInstance()->getConfigMap()["workernum"])),
       _maxRecord(stoul(Configuration::getInstance()->getConfigMap()["recordnum"])),
-      _caches(_cacheNums, _maxRecord) // 创建 _cacheNums 个 cache group 对象（这里在构造对象时还要传入 _maxRecord）
+      _epoch(0),
+      _snapshotPath(Configuration::getInstance()->get("cachesnapshot", "")),
+      _snapshotPeriod(Configuration::getInstance()->getNumber("snapshotperiod", 0)),
+      _syncCount(0),
+      _generation(0),
+      _droppedRecords(0),
+      _fullCopies(0)
 {
-    // // 加载
-    // for (auto &group : _caches)
-    // {
-    //     group.load(Configuration::getInstance()->getConfigMap()["LRU"]);
-    // }
+    _options.policy = parsePolicy();
+    _options.byteBudget = Configuration::getInstance()->getNumber("cachebytes", 0);
+    _options.compressBytes = Configuration::getInstance()->getNumber("compressbytes", 0);
+#ifndef USE_LZ4
+    if (_options.compressBytes != 0)
+    {
+        LogWarn("compressbytes is ignored: built without USE_LZ4");
+        _options.compressBytes = 0;
+    }
+#endif
+    if (_mode == CacheMode::Group)
+    {
+        size_t logCapacity = Configuration::getInstance()->getNumber("synclognum", 4096); // 每个线程两次同步之间最多记录的新记录数
+        CacheOptions groupOptions = _options;
+        groupOptions.byteBudget = _options.byteBudget / (_cacheNums + 1); // 每条记录在各线程的 cache 与 _mergedCache 中各存一份
+        if (_options.byteBudget != 0 && groupOptions.byteBudget == 0)
+            groupOptions.byteBudget = 1;
+        for (size_t idx = 0; idx < _cacheNums; ++idx)
+            _caches.emplace_back(new CacheGroup(idx, _maxRecord, logCapacity, groupOptions));
+        _mergedCache.reset(new LRUCache(_maxRecord, groupOptions));
+    }
+    else if (_mode == CacheMode::Shared)
+    {
+        size_t shardNum = std::max<size_t>(Configuration::getInstance()->getNumber("cacheshards", 16), 1);
+        CacheOptions shardOptions = _options;
+        shardOptions.byteBudget = _options.byteBudget / shardNum; // 总预算平分给各分片
+        if (_options.byteBudget != 0 && shardOptions.byteBudget == 0)
+            shardOptions.byteBudget = 1;
+        for (size_t idx = 0; idx < shardNum; ++idx)
+            _shards.emplace_back(new CacheShard(_maxRecord / shardNum + 1, shardOptions));
+    }
 }
 
 void CacheManager::destroy()
@@ -45,44 +95,386 @@ void CacheManager::destroy()
     }
 }
 
+CacheMode CacheManager::parseMode()
+{
+    string mode = Configuration::getInstance()->get("cachemode", "group");
+    if (mode == "shared")
+        return CacheMode::Shared;
+    if (mode != "group")
+        LogWarn("unknown cachemode %s, use group", mode.c_str());
+    return CacheMode::Group;
+}
+
+CachePolicy CacheManager::parsePolicy()
+{
+    string policy = Configuration::getInstance()->get("cachepolicy", "lru");
+    if (policy == "tinylfu")
+        return CachePolicy::TinyLfu;
+    if (policy != "lru")
+        LogWarn("unknown cachepolicy %s, use lru", policy.c_str());
+    return CachePolicy::Lru;
+}
+
+CacheMode CacheManager::getMode() const
+{
+    return _mode;
+}
+
+/**
+ *  查询缓存：group 模式查当前线程的 cache group，shared 模式查键所在的分片
+ *
+ *  1. 分片取哈希值的高位，LRUCache 的索引取低位，二者互不相关
+ */
+LRUCache::Value CacheManager::getRecord(const string &query)
+{
+    if (_mode == CacheMode::Group)
+    {
+        CacheGroup &group = *_caches[__thread_id];
+        applyDeltas(group);
+        return group.getRecord(query);
+    }
+
+    size_t hash = std::hash<string>()(query);
+    CacheShard &shard = *_shards[(hash >> 32) % _shards.size()];
+    MutexLockGuard autolock(shard.mutex);
+    return shard.cache.getRecord(query, hash);
+}
+
+void CacheManager::insertRecord(const string &query, const LRUCache::Value &result, uint32_t cost)
+{
+    if (_mode == CacheMode::Group)
+    {
+        CacheGroup &group = *_caches[__thread_id];
+        applyDeltas(group);
+        group.insertRecord(query, result, cost);
+        return;
+    }
+
+    size_t hash = std::hash<string>()(query);
+    CacheShard &shard = *_shards[(hash >> 32) % _shards.size()];
+    MutexLockGuard autolock(shard.mutex);
+    shard.cache.insertRecord(query, result, cost, hash);
+}
+
+uint64_t CacheManager::getDroppedRecords() const
+{
+    return _droppedRecords.load(std::memory_order_relaxed);
+}
+
+uint64_t CacheManager::getFullCopies() const
+{
+    return _fullCopies.load(std::memory_order_relaxed);
+}
+
+/**
+ *  由工作线程调用：应用本线程尚未应用的增量（无事可做时只有两次原子读）
+ *
+ *  1. 定时线程要求时，先提交本线程 cache 的全量副本
+ *  2. 落后超过 SYNC_HISTORY 个版本时，更早的增量已丢弃，改为从 _mergedCache 全量复制
+ */
+void CacheManager::applyDeltas(CacheGroup &group)
+{
+    if (group._copyRequested.load(std::memory_order_acquire))
+        submitCopy(group);
+    if (group._appliedEpoch == _epoch.load(std::memory_order_acquire))
+        return;
+
+    vector<shared_ptr<const vector<CacheRecord>>> deltas;
+    bool isBehind = false;
+    {
+        MutexLockGuard autolock(_deltaMutex);
+        isBehind = _deltas.front().first > group._appliedEpoch + 1; // 有未应用的增量已被丢弃
+        for (auto &delta : _deltas)
+        {
+            if (!isBehind && delta.first > group._appliedEpoch)
+                deltas.push_back(delta.second);
+        }
+        group._appliedEpoch = _deltas.back().first;
+    }
+    if (isBehind) // _mergedCache 先于发布更新，已包含 _appliedEpoch 及之前的全部记录
+    {
+        copyMerged(group);
+        return;
+    }
+
+    for (auto &delta : deltas)
+    {
+        for (auto &record : *delta)
+        {
+            if (record.origin != group._id) // 自己产生的记录已在本线程的 cache 中
+                group._mainCache.insertRecord(record.key, record.value, record.cost);
+        }
+    }
+}
+
+/**
+ *  由工作线程调用：从 _mergedCache 复制全部记录到本线程的 cache（按从旧到新的顺序）
+ */
+void CacheManager::copyMerged(CacheGroup &group)
+{
+    vector<CacheRecord> records;
+    {
+        MutexLockGuard autolock(_mergedMutex);
+        _mergedCache->forEach([&records](const string &query, const LRUCache::Value &result, uint32_t cost) {
+            records.push_back({query, result, cost, SNAPSHOT_ORIGIN});
+        });
+    }
+    for (auto &record : records)
+        group._mainCache.insertRecord(record.key, record.value, record.cost);
+    _fullCopies.fetch_add(1, std::memory_order_relaxed);
+    LogWarn("cache worker %lu fell behind, copied %lu records", group._id, records.size());
+}
+
+/**
+ *  由工作线程调用：提交本线程 cache 的全量副本（日志曾满而丢失记录时），由下一次同步发布
+ */
+void CacheManager::submitCopy(CacheGroup &group)
+{
+    group._copyRequested.store(false, std::memory_order_relaxed);
+    vector<CacheRecord> records;
+    group._mainCache.forEach([&records, &group](const string &query, const LRUCache::Value &result, uint32_t cost) {
+        records.push_back({query, result, cost, group._id});
+    });
+
+    MutexLockGuard autolock(_copyMutex);
+    std::move(records.begin(), records.end(), std::back_inserter(_copies));
+    _fullCopies.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ *  由定时线程调用：group 模式下同步各线程的 cache；按配置周期写快照
+ */
 void CacheManager::sync()
 {
-    using namespace std;
-    cout << "timer thread: start sync" << endl;
+    if (_mode == CacheMode::Group) // 共享 cache 无需同步
+        mergeLogs();
+    if (_snapshotPeriod != 0 && ++_syncCount % _snapshotPeriod == 0)
+        dumpSnapshot();
+}
+
+/**
+ *  取走各工作线程提交的全量副本与日志，合并去重（同一键保留最新的结果）后发布为新版本
+ *
+ *  1. 日志曾满的工作线程被要求提交全量副本，副本在其后的某次同步中发布
+ */
+void CacheManager::mergeLogs()
+{
+    vector<CacheRecord> delta;
+    {
+        MutexLockGuard autolock(_copyMutex);
+        delta.swap(_copies);
+    }
 
-    auto &first_group = _caches[0];//first_group : CacheGroup
-    first_group._onlyRead = true;
+    unordered_map<string, size_t> positions; // 键在 delta 中的下标
+    for (size_t idx = 0; idx < delta.size(); ++idx)
+        positions[delta[idx].key] = idx;
+    CacheRecord record;
     for (auto &group : _caches)
     {
-        auto &pendingCache = group._pendingUpdateCache;
-#ifdef __DEBUG__
-        // printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-        cout << "group._pengdingCache.size() = " << pendingCache.size() << endl;
-#endif
-        for (auto &record : pendingCache._resultList)
+        while (group->_log.pop(record))
         {
-            first_group.insertRecord(record.first, record.second);
-#ifdef __DEBUG__
-            // printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-            cout << "first_group._mainCache.size() = " << first_group._mainCache.size() << endl;
-#endif
+            auto it = positions.find(record.key);
+            if (it != positions.end())
+                delta[it->second] = std::move(record);
+            else
+            {
+                positions.emplace(record.key, delta.size());
+                delta.push_back(std::move(record));
+            }
         }
-        pendingCache.clear();
+
+        size_t dropped = group->_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped != 0)
+        {
+            _droppedRecords.fetch_add(dropped, std::memory_order_relaxed);
+            group->_copyRequested.store(true, std::memory_order_release);
+            LogWarn("cache worker %lu dropped %lu records (synclognum too small), full copy requested", group->_id, dropped);
+        }
+    }
+    if (delta.empty())
+        return;
+
+    {
+        MutexLockGuard autolock(_mergedMutex);
+        for (auto &record : delta)
+            _mergedCache->insertRecord(record.key, record.value, record.cost);
     }
+    publish(std::move(delta));
+}
 
-    // first_group.dump(Configuration::getInstance()->getConfigMap()["LRU"]);
+/**
+ *  将一批记录发布为新版本的增量，工作线程在下次访问缓存时应用
+ */
+void CacheManager::publish(vector<CacheRecord> &&delta)
+{
+    MutexLockGuard autolock(_deltaMutex);
+    uint64_t epoch = _epoch.load(std::memory_order_relaxed) + 1;
+    _deltas.emplace_back(epoch, std::make_shared<const vector<CacheRecord>>(std::move(delta)));
+    if (_deltas.size() > SYNC_HISTORY)
+        _deltas.pop_front();
+    _epoch.store(epoch, std::memory_order_release);
+    LogInfo("\n\tcache sync: epoch %lu, %lu records", epoch, _deltas.back().second->size());
+}
+/**
+ *  启动异步加载快照的线程（由 EchoServer 在开始服务前调用）
+ */
+void CacheManager::loadSnapshot(uint64_t generation)
+{
+    _generation = generation;
+    if (_snapshotPath.empty())
+        return;
+    _loader.reset(new Thread(std::bind(&CacheManager::doLoadSnapshot, this)));
+    _loader->create();
+}
 
-    for (auto &group : _caches)
+void CacheManager::joinLoader()
+{
+    if (_loader)
     {
-        group._onlyRead = true;
-        group.update(first_group);
-        group._onlyRead = false;
+        _loader->join();
+        _loader.reset();
     }
-    first_group._onlyRead = false;
+}
 
-#ifdef __DEBUG__
-    printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-    cout << "timer thread: end sync" << endl;
-#endif
+/**
+ *  加载线程：读入并校验快照，按从旧到新的顺序放入 cache
+ *
+ *  1. 文件不完整时保留已读出的记录
+ */
+void CacheManager::doLoadSnapshot()
+{
+    ifstream ifs(_snapshotPath, std::ios::binary);
+    if (!ifs)
+    {
+        LogInfo("\n\tno cache snapshot: %s", _snapshotPath.c_str());
+        return;
+    }
+    string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    BinaryReader reader(data);
+    uint32_t magic = 0, version = 0;
+    uint64_t generation = 0, count = 0;
+    reader.getU32(magic);
+    reader.getU32(version);
+    reader.getU64(generation);
+    reader.getU64(count);
+    if (!reader.good() || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION)
+    {
+        LogWarn("bad cache snapshot: %s", _snapshotPath.c_str());
+        return;
+    }
+    if (generation != _generation)
+    {
+        LogInfo("\n\tcache snapshot is stale (index changed): %s", _snapshotPath.c_str());
+        return;
+    }
+
+    vector<CacheRecord> records;
+    records.reserve(std::min<uint64_t>(count, _maxRecord));
+    for (uint64_t idx = 0; idx < count; ++idx)
+    {
+        CacheRecord record;
+        string value;
+        reader.getString(record.key);
+        reader.getString(value);
+        reader.getU32(record.cost);
+        if (!reader.good())
+        {
+            LogWarn("truncated cache snapshot: %s", _snapshotPath.c_str());
+            break;
+        }
+        record.value = std::make_shared<const string>(std::move(value));
+        record.origin = SNAPSHOT_ORIGIN;
+        records.push_back(std::move(record));
+    }
+
+    size_t loaded = records.size();
+    if (_mode == CacheMode::Group)
+    {
+        {
+            MutexLockGuard autolock(_mergedMutex);
+            for (auto &record : records)
+                _mergedCache->insertRecord(record.key, record.value, record.cost);
+        }
+        publish(std::move(records));
+    }
+    else
+    {
+        for (auto &record : records)
+        {
+            size_t hash = std::hash<string>()(record.key);
+            CacheShard &shard = *_shards[(hash >> 32) % _shards.size()];
+            MutexLockGuard autolock(shard.mutex);
+            shard.cache.insertRecord(record.key, record.value, record.cost, hash);
+        }
+    }
+    LogInfo("\n\tcache snapshot loaded: %lu records", loaded);
+}
+
+/**
+ *  取出 cache 中的全部记录（按从旧到新的顺序；结果共享，不复制）
+ */
+void CacheManager::collectRecords(vector<CacheRecord> &records)
+{
+    auto collect = [&records](const string &query, const LRUCache::Value &result, uint32_t cost) {
+        records.push_back({query, result, cost, SNAPSHOT_ORIGIN});
+    };
+
+    if (_mode == CacheMode::Group)
+    {
+        MutexLockGuard autolock(_mergedMutex);
+        _mergedCache->forEach(collect);
+        return;
+    }
+    for (auto &shard : _shards)
+    {
+        MutexLockGuard autolock(shard->mutex);
+        shard->cache.forEach(collect);
+    }
+}
+
+/**
+ *  写快照（由定时线程周期调用，退出时由 EchoServer 在工作线程结束后调用）
+ */
+void CacheManager::dumpSnapshot()
+{
+    if (_snapshotPath.empty())
+        return;
+
+    joinLoader(); // 快照尚未加载完时不写，避免覆盖
+    if (_mode == CacheMode::Group)
+        mergeLogs(); // 收齐各线程尚未同步的新记录
+
+    vector<CacheRecord> records;
+    collectRecords(records);
+
+    string tmpPath = _snapshotPath + ".tmp";
+    ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+    {
+        LogError("can not open %s", tmpPath.c_str());
+        return;
+    }
+
+    string buffer;
+    BinaryWriter writer(buffer);
+    writer.putU32(SNAPSHOT_MAGIC).putU32(SNAPSHOT_VERSION).putU64(_generation).putU64(records.size());
+    for (auto &record : records)
+    {
+        writer.putString(record.key).putString(*record.value).putU32(record.cost);
+        if (buffer.size() >= (1 << 20)) // 每攒够 1MB 写一次
+        {
+            ofs.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    ofs.write(buffer.data(), buffer.size());
+    ofs.close();
+    if (!ofs || ::rename(tmpPath.c_str(), _snapshotPath.c_str()) != 0)
+    {
+        LogError("write cache snapshot %s failed", _snapshotPath.c_str());
+        return;
+    }
+    LogInfo("\n\tcache snapshot written: %lu records", records.size());
 }
 }; // namespace wdcpp
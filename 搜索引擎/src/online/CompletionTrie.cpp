@@ -0,0 +1,99 @@
+#include "CompletionTrie.h"
+#include "MyLog.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wdcpp
+{
+CompletionTrie::CompletionTrie()
+    : _data(nullptr),
+      _size(0),
+      _header(nullptr),
+      _units(nullptr),
+      _tops(nullptr)
+{
+}
+
+CompletionTrie::~CompletionTrie()
+{
+    if (_data)
+        ::munmap((void *)_data, _size);
+}
+
+/**
+ *  映射前缀补全文件，并校验文件头与长度
+ */
+bool CompletionTrie::load(const string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        LogError("can not open %s", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(CompletionHeader))
+    {
+        LogError("bad completion trie: %s", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        LogError("mmap %s failed", path.c_str());
+        return false;
+    }
+
+    const CompletionHeader *header = (const CompletionHeader *)addr;
+    size_t expected = sizeof(CompletionHeader) + (size_t)header->unitCount * sizeof(CompletionUnit) +
+                      header->topCount * sizeof(uint32_t);
+    if (header->magic != COMPLETION_MAGIC || header->version != COMPLETION_VERSION ||
+        header->unitCount == 0 || expected != (size_t)st.st_size)
+    {
+        LogError("bad completion trie: %s", path.c_str());
+        ::munmap(addr, st.st_size);
+        return false;
+    }
+
+    _data = (const char *)addr;
+    _size = st.st_size;
+    _header = header;
+    _units = (const CompletionUnit *)(_data + sizeof(CompletionHeader));
+    _tops = (const uint32_t *)(_data + sizeof(CompletionHeader) + (size_t)header->unitCount * sizeof(CompletionUnit));
+    LogInfo("completion trie loaded: %u units, top %u", _header->unitCount, _header->topK);
+    return true;
+}
+
+bool CompletionTrie::available() const
+{
+    return _header != nullptr;
+}
+
+/**
+ *  沿 prefix 逐字节转移，将到达结点的补全列表（词编号，按词频降序）追加到 ids 中
+ *
+ *  1. 前缀不在 trie 中时返回 false
+ */
+bool CompletionTrie::complete(string_view prefix, vector<uint32_t> &ids) const
+{
+    int32_t state = 0;
+    for (unsigned char ch : prefix)
+    {
+        int64_t next = (int64_t)_units[state].base + ch + 1;
+        if (next <= 0 || next >= _header->unitCount || _units[next].check != state)
+            return false;
+        state = next;
+    }
+
+    const CompletionUnit &unit = _units[state];
+    if ((uint64_t)unit.topBegin + unit.topCount > _header->topCount)
+        return false;
+    ids.insert(ids.end(), _tops + unit.topBegin, _tops + unit.topBegin + unit.topCount);
+    return true;
+}
+}; // namespace wdcpp
@@ -0,0 +1,65 @@
+#include "CursorCache.h"
+#include "MutexLockGuard.h"
+
+namespace wdcpp
+{
+CursorCache::CursorCache(size_t capacity, int ttl)
+    : _capacity(capacity),
+      _ttl(ttl),
+      _nextCursor((Cursor)::time(nullptr) << 20) // 以启动时间为高位，避免重启后与旧游标重复
+{
+}
+
+/**
+ *  存入一份排好序的结果，返回指向它的游标
+ */
+CursorCache::Cursor CursorCache::put(const RankedListPtr &rankedList)
+{
+    time_t now = ::time(nullptr);
+
+    MutexLockGuard autolock(_mutex);
+    expire(now);
+
+    Cursor cursor = ++_nextCursor;
+    _entryList.push_front({cursor, rankedList, now + _ttl});
+    _hashMap[cursor] = _entryList.begin();
+    if (_entryList.size() > _capacity) // 已满，淘汰最久未访问的游标
+    {
+        _hashMap.erase(_entryList.back().cursor);
+        _entryList.pop_back();
+    }
+    return cursor;
+}
+
+/**
+ *  凭游标取回结果，游标不存在或已过期则返回 nullptr
+ */
+CursorCache::RankedListPtr CursorCache::get(Cursor cursor)
+{
+    time_t now = ::time(nullptr);
+
+    MutexLockGuard autolock(_mutex);
+    expire(now);
+
+    auto it = _hashMap.find(cursor);
+    if (it == _hashMap.end())
+        return nullptr;
+
+    // 续期并移至 _entryList 头部
+    it->second->expireTime = now + _ttl;
+    _entryList.splice(_entryList.begin(), _entryList, it->second);
+    return it->second->rankedList;
+}
+
+/**
+ *  从尾部开始清除所有已过期的游标（调用前须已加锁）
+ */
+void CursorCache::expire(time_t now)
+{
+    while (!_entryList.empty() && _entryList.back().expireTime <= now)
+    {
+        _hashMap.erase(_entryList.back().cursor);
+        _entryList.pop_back();
+    }
+}
+}; // namespace wdcpp
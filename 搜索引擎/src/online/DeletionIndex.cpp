@@ -0,0 +1,103 @@
+#include "DeletionIndex.h"
+#include "MyLog.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wdcpp
+{
+DeletionIndex::DeletionIndex()
+    : _data(nullptr),
+      _size(0),
+      _header(nullptr),
+      _slots(nullptr),
+      _ids(nullptr),
+      _slotMask(0)
+{
+}
+
+DeletionIndex::~DeletionIndex()
+{
+    if (_data)
+        ::munmap((void *)_data, _size);
+}
+
+/**
+ *  映射删除变体索引文件，并校验文件头与长度
+ */
+bool DeletionIndex::load(const string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        LogError("can not open %s", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(DeletionHeader))
+    {
+        LogError("bad deletion index: %s", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        LogError("mmap %s failed", path.c_str());
+        return false;
+    }
+
+    const DeletionHeader *header = (const DeletionHeader *)addr;
+    size_t slotNum = header->slotBits < 32 ? (size_t)1 << header->slotBits : 0;
+    size_t expected = sizeof(DeletionHeader) + slotNum * sizeof(DeletionSlot) + header->idCount * sizeof(uint32_t);
+    if (header->magic != DELETION_MAGIC || header->version != DELETION_VERSION ||
+        slotNum == 0 || expected != (size_t)st.st_size)
+    {
+        LogError("bad deletion index: %s", path.c_str());
+        ::munmap(addr, st.st_size);
+        return false;
+    }
+
+    _data = (const char *)addr;
+    _size = st.st_size;
+    _header = header;
+    _slots = (const DeletionSlot *)(_data + sizeof(DeletionHeader));
+    _ids = (const uint32_t *)(_data + sizeof(DeletionHeader) + slotNum * sizeof(DeletionSlot));
+    _slotMask = slotNum - 1;
+    LogInfo("deletion index loaded: maxDist = %u, %lu ids", _header->maxDist, (size_t)_header->idCount);
+    return true;
+}
+
+bool DeletionIndex::available() const
+{
+    return _header != nullptr;
+}
+
+int DeletionIndex::maxDist() const
+{
+    return _header ? _header->maxDist : 0;
+}
+
+/**
+ *  将变体 hash 对应的词编号追加到 ids 中（线性探测，遇到空槽即不存在）
+ */
+void DeletionIndex::lookup(uint64_t hash, vector<uint32_t> &ids) const
+{
+    uint64_t slot = hash & _slotMask;
+    for (uint64_t probe = 0; probe <= _slotMask; ++probe, slot = (slot + 1) & _slotMask)
+    {
+        const DeletionSlot &entry = _slots[slot];
+        if (entry.hash == 0)
+            return;
+        if (entry.hash == hash)
+        {
+            if ((uint64_t)entry.begin + entry.count <= _header->idCount)
+                ids.insert(ids.end(), _ids + entry.begin, _ids + entry.begin + entry.count);
+            return;
+        }
+    }
+}
+}; // namespace wdcpp
@@ -1,5 +1,6 @@
 #include "Dictionary.h"
 #include "Configuration.h"
+#include "MultiBytesCharacter.h"
 
 #include <iostream>
 #include <sstream>
@@ -20,6 +21,9 @@ Dictionary *Dictionary::getInstance()
         _singletonDict = new Dictionary();
         _singletonDict->initDict();
         _singletonDict->initIndex();
+        _singletonDict->initGramIndex();
+        _singletonDict->initDeletionIndex();
+        _singletonDict->initCompletionTrie();
         atexit(destory);
     }
     return _singletonDict;
@@ -52,6 +56,7 @@ void Dictionary::initDict()
         string word, freq;
         iss >> word >> freq;
         _dict.push_back(pair<string, int>(word, freq == "" ? 0 : (stoi(freq))));//stoi 将string型的数字，转换为int型
+        _codepoints.push_back(decodeUtf8(word));
     }
 }
 
@@ -85,14 +90,79 @@ void Dictionary::initIndex() // key : set<id>
 
 
 
+/**
+ *  由预先解码的词建立二元组索引（按词编号顺序插入，因此每个列表都是升序）
+ */
+void Dictionary::initGramIndex()
+{
+    cout << "initialize gram index" << endl;
+    for (size_t id = 0; id < _codepoints.size(); ++id)
+    {
+        const u32string &word = _codepoints[id];
+        char32_t prev = GRAM_PAD;
+        for (char32_t ch : word)
+        {
+            _gramIndex[gramKey(prev, ch)].push_back(id);
+            prev = ch;
+        }
+        _gramIndex[gramKey(prev, GRAM_PAD)].push_back(id);
+    }
+}
+
+/**
+ *  映射删除变体索引（可选，未配置时关键词推荐使用二元组索引）
+ */
+void Dictionary::initDeletionIndex()
+{
+    string deletesPath = Configuration::getInstance()->get("dictDeletes", "");
+    if (deletesPath.empty())
+        return;
+    cout << "initialize deletion index" << endl;
+    if (!_deletionIndex.load(deletesPath))
+        cout << "load " << deletesPath << " error !" << endl;
+}
+
+/**
+ *  映射前缀补全 trie（可选，未配置时不提供前缀补全）
+ */
+void Dictionary::initCompletionTrie()
+{
+    string completionsPath = Configuration::getInstance()->get("dictCompletions", "");
+    if (completionsPath.empty())
+        return;
+    cout << "initialize completion trie" << endl;
+    if (!_completionTrie.load(completionsPath))
+        cout << "load " << completionsPath << " error !" << endl;
+}
+
 const vector<pair<string, int>> &Dictionary::getDict()
 {
     return _dict;
 }
 
+const vector<u32string> &Dictionary::getCodepoints()
+{
+    return _codepoints;
+}
+
 const map<string, set<int>> &Dictionary::getIndexTable()
 {
     return _index;
 }
 
+const unordered_map<uint64_t, vector<int>> &Dictionary::getGramIndex()
+{
+    return _gramIndex;
+}
+
+const DeletionIndex &Dictionary::getDeletionIndex()
+{
+    return _deletionIndex;
+}
+
+const CompletionTrie &Dictionary::getCompletionTrie()
+{
+    return _completionTrie;
+}
+
 };
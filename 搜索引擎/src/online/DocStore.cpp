@@ -0,0 +1,128 @@
+#include "DocStore.h"
+
+#include <ErrorCheck>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+using std::ifstream;
+using std::istringstream;
+
+namespace wdcpp
+{
+/**
+ *  读入网页库与偏移库
+ *
+ *  1. 网页库整体读入 _arena，只分配一次内存
+ *  2. 偏移库每行为 "docid beg len [staticRank]"，据此切分出每篇网页
+ */
+void DocStore::load(const string &ripepagePath, const string &offsetPath)
+{
+    ifstream ripepageLib(ripepagePath, std::ios::binary | std::ios::ate); // 定位到尾部
+    if (!ripepageLib)
+    {
+        ERROR_PRINT("can not open ripepage.dat");
+        exit(EXIT_FAILURE);
+    }
+    size_t length = ripepageLib.tellg(); // 网页库总长度
+    ripepageLib.seekg(0, std::ios::beg);
+    _arena.resize(length);
+    ripepageLib.read(&_arena[0], length);
+    ripepageLib.close();
+
+    ifstream offsetLib(offsetPath);
+    if (!offsetLib)
+    {
+        ERROR_PRINT("can not open offset.dat");
+        exit(EXIT_FAILURE);
+    }
+    string offsetLine;
+    PageID docid;
+    size_t beg, len;
+    double staticRank;
+    while (getline(offsetLib, offsetLine))
+    {
+        istringstream iss(offsetLine);
+        if (!(iss >> docid >> beg >> len) || docid < 0 || beg + len > _arena.size())
+        {
+            ERROR_PRINT("bad line in offset.dat: %s\n", offsetLine.c_str());
+            continue;
+        }
+
+        if (!(iss >> staticRank)) // 旧版偏移库没有静态排名
+            staticRank = 0.0;
+
+        DocEntry entry;
+        entry.staticRank = staticRank;
+        if (!parseDoc(beg, len, entry))
+        {
+            ERROR_PRINT("bad doc in ripepage.dat: docid = %ld\n", docid);
+            continue;
+        }
+        if ((size_t)docid >= _entries.size())
+            _entries.resize(docid + 1, DocEntry{-1, {0, 0}, {0, 0}, {0, 0}, {0, 0}, 0.0});
+        _entries[docid] = entry;
+    }
+    offsetLib.close();
+}
+
+/**
+ *  获取网页 ID 的只读视图
+ */
+DocView DocStore::getDoc(PageID ID) const
+{
+    const DocEntry &entry = _entries[ID];
+    return {entry.docID, view(entry.doc), view(entry.title), view(entry.url), view(entry.content)};
+}
+
+double DocStore::getStaticRank(PageID ID) const
+{
+    return _entries[ID].staticRank;
+}
+
+size_t DocStore::size() const
+{
+    return _entries.size();
+}
+
+/**
+ *  解析 _arena 中从 beg 开始、长 len 字节的 <doc>...</doc>
+ *
+ *  1. 每个字段的格式均为 "<tag> value </tag>"（注意：value 前后各有一个空格）
+ *  2. 只记录位置，不拷贝文本
+ */
+bool DocStore::parseDoc(size_t beg, size_t len, DocEntry &entry) const
+{
+    string_view doc(_arena.data() + beg, len);
+
+    auto findField = [&](string_view tag, Field &field) {
+        string openTag = "<" + string(tag) + ">";
+        string closeTag = "</" + string(tag) + ">";
+        size_t open = doc.find(openTag);
+        size_t close = doc.find(closeTag);
+        if (open == doc.npos || close == doc.npos)
+            return false;
+        size_t start = open + openTag.size() + 1; // 跳过 "<tag> "
+        if (close < start + 1)                     // 去掉 " </tag>" 前的空格
+            return false;
+        field.beg = beg + start;
+        field.len = close - start - 1;
+        return true;
+    };
+
+    Field docid;
+    if (!findField("docid", docid) ||
+        !findField("title", entry.title) ||
+        !findField("url", entry.url) ||
+        !findField("content", entry.content))
+        return false;
+
+    entry.docID = ::strtol(string(view(docid)).c_str(), nullptr, 10);
+    entry.doc = {beg, len};
+    return true;
+}
+
+string_view DocStore::view(const Field &field) const
+{
+    return string_view(_arena.data() + field.beg, field.len);
+}
+}; // namespace wdcpp
@@ -3,6 +3,9 @@
 #include "MyLog.h"
 #include "TimerTask.h"
 #include "Configuration.h"
+#include "CacheManager.h"
+
+#include <signal.h>
 
 namespace wdcpp
 {
@@ -11,15 +14,35 @@ EchoServer::EchoServer(const string &ip, unsigned short port)
       _server(ip, port),
       _webPageSearcher(),
       _recommander(),
-      _redis("tcp://127.0.0.1:6379"),
+      _redis(Configuration::getInstance()->get("redis", "tcp://127.0.0.1:6379")),
+      _pageSize(Configuration::getInstance()->getNumber("pagesize", 5)),
+      _queryBudget(Configuration::getInstance()->getNumber("querybudget", 200)),
       _timerThread(std::bind(&TimerTask::process, TimerTask()),
                    stoi(Configuration::getInstance()->getConfigMap()["initTime"]),
-                   stoi(Configuration::getInstance()->getConfigMap()["periodicTime"]))
+                   stoi(Configuration::getInstance()->getConfigMap()["periodicTime"])),
+      _signalThread(std::bind(&EchoServer::waitSignal, this))
 {
 }
 
+/**
+ *  开启服务，事件循环退出（收到 SIGINT/SIGTERM）后调用 stop 再返回
+ *
+ *  1. 在创建任何线程之前屏蔽 SIGINT/SIGTERM，之后创建的线程都继承该屏蔽，
+ *     信号只由 _signalThread 用 sigwait 同步接收，无需异步信号处理函数
+ */
 void EchoServer::start()
 {
+    sigset_t signals;
+    ::sigemptyset(&signals);
+    ::sigaddset(&signals, SIGINT);
+    ::sigaddset(&signals, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    _signalThread.create();
+
+    _redis.start();
+
+    CacheManager::getInstance()->loadSnapshot(_webPageSearcher.getGeneration()); // 异步加载，不等待
+
     _pool.start();
 
     _timerThread.start();
@@ -29,16 +52,40 @@ void EchoServer::start()
     _server.setMessageCallBack(std::bind(&EchoServer::onMessage, this, _1));
     _server.setCloseCallBack(std::bind(&EchoServer::onClose, this, _1));
 
-    _server.start();
+    _server.start(); // 直到 _signalThread 收到信号才返回
+
+    stop();
 }
 
+/**
+ *  退出：事件循环已退出，依次停止各线程，最后写缓存快照
+ */
 void EchoServer::stop()
 {
-    _server.stop();
+    _signalThread.join();
 
     _timerThread.stop();
 
-    _pool.stop();
+    _redis.stop(); // 先停 redis：已发出 GET 的回调可能还要把查词典的任务交给线程池
+
+    _pool.stop(); // redis 已停止，此后的关键词查询直接查词典
+
+    CacheManager::getInstance()->dumpSnapshot(); // 工作线程都已退出，cache 不会再变
+}
+
+/**
+ *  _signalThread：等待 SIGINT/SIGTERM，收到后退出事件循环（由主线程继续完成 stop）
+ */
+void EchoServer::waitSignal()
+{
+    sigset_t signals;
+    ::sigemptyset(&signals);
+    ::sigaddset(&signals, SIGINT);
+    ::sigaddset(&signals, SIGTERM);
+    int signo = 0;
+    ::sigwait(&signals, &signo);
+    LogInfo("\n\treceived signal %d, stopping", signo);
+    _server.stop();
 }
 
 void EchoServer::onConnection(const TcpConnectionPtr &connPtr)
@@ -49,11 +96,17 @@ void EchoServer::onConnection(const TcpConnectionPtr &connPtr)
 
 void EchoServer::onMessage(const TcpConnectionPtr &connPtr)
 {
-    // recv
-    string msg = connPtr->recv();
+    // recv（二进制协议或小火车协议）
+    Message msg = connPtr->recvMessage();
+    if (!msg.valid)
+    {
+        LogError("\n\t%s sent a bad frame, closing", connPtr->show().c_str());
+        connPtr->shutdown(); // 坏帧的报文体未读出，字节流已无法对齐
+        return;
+    }
 
     // decode -> compute -> encode -> send
-    MyTask task(msg, connPtr, _webPageSearcher, _recommander, _redis);
+    MyTask task(std::move(msg), connPtr, _webPageSearcher, _recommander, _redis, _pool, _pageSize, _queryBudget);
     _pool.addTask(std::bind(&MyTask::process, task)); // 因此 ThreadPool ..> MyTask
     // _pool.addTask(std::bind(&MyTask::process, &task));
 }
@@ -0,0 +1,147 @@
+#include "EditDistance.h"
+
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+namespace wdcpp
+{
+/**
+ *  预处理模式串
+ *
+ *  1. peq[c] 的第 i 位为 1 表示 pattern[i] == c
+ *  2. 超过 64 个字符的模式串不建位图（使用动态规划）
+ */
+EditDistance::EditDistance(const u32string &pattern)
+    : _pattern(pattern)
+{
+    ::memset(_asciiPeq, 0, sizeof(_asciiPeq));
+    if (_pattern.size() > WORD_BITS)
+        return;
+
+    for (size_t idx = 0; idx < _pattern.size(); ++idx)
+    {
+        char32_t ch = _pattern[idx];
+        if (ch < ASCII_SIZE)
+            _asciiPeq[ch] |= (uint64_t)1 << idx;
+        else
+            _widePeq.push_back({ch, (uint64_t)1 << idx});
+    }
+
+    // 合并同一码点的位图
+    std::sort(_widePeq.begin(), _widePeq.end());
+    size_t last = 0;
+    for (size_t idx = 0; idx < _widePeq.size(); ++idx)
+    {
+        if (last > 0 && _widePeq[last - 1].first == _widePeq[idx].first)
+            _widePeq[last - 1].second |= _widePeq[idx].second;
+        else
+            _widePeq[last++] = _widePeq[idx];
+    }
+    _widePeq.resize(last);
+}
+
+int EditDistance::distance(const u32string &text) const
+{
+    return distance(text, INT_MAX - 1);
+}
+
+/**
+ *  计算模式串与 text 的编辑距离，超过 maxDist 时返回 maxDist + 1
+ */
+int EditDistance::distance(const u32string &text, int maxDist) const
+{
+    size_t m = _pattern.size();
+    size_t n = text.size();
+    size_t lengthDiff = m > n ? m - n : n - m;
+    if (lengthDiff > (size_t)maxDist) // 编辑距离不小于长度差
+        return maxDist + 1;
+    if (m == 0 || n == 0)
+        return std::max(m, n);
+
+    if (m <= WORD_BITS)
+        return myers(text, maxDist);
+    return dynamic(text, maxDist);
+}
+
+uint64_t EditDistance::peq(char32_t ch) const
+{
+    if (ch < ASCII_SIZE)
+        return _asciiPeq[ch];
+    auto it = std::lower_bound(_widePeq.begin(), _widePeq.end(), pair<char32_t, uint64_t>(ch, 0));
+    return (it != _widePeq.end() && it->first == ch) ? it->second : 0;
+}
+
+/**
+ *  Myers / Hyyrö 位并行算法
+ *
+ *  1. Pv / Mv 记录 DP 矩阵当前列相邻两行之差为 +1 / -1 的位置，score 为最后一行的值
+ *  2. 第 0 行为 D[0][j] = j，因此水平差向量移位时补 1
+ *  3. 已处理 j 个字符时，最终结果不小于 score - (n - j)，超过 maxDist 即可提前结束
+ */
+int EditDistance::myers(const u32string &text, int maxDist) const
+{
+    size_t m = _pattern.size();
+    size_t n = text.size();
+    const uint64_t last = (uint64_t)1 << (m - 1);
+
+    uint64_t pv = ~(uint64_t)0;
+    uint64_t mv = 0;
+    int score = m;
+    for (size_t j = 0; j < n; ++j)
+    {
+        uint64_t eq = peq(text[j]);
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last)
+            ++score;
+        else if (mh & last)
+            --score;
+
+        if (score - (int)(n - j - 1) > maxDist)
+            return maxDist + 1;
+
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/**
+ *  按行滚动的动态规划（模式串超过 64 个字符时使用）
+ *
+ *  1. 只保留一列，缓冲区由本线程复用
+ *  2. 一列的最小值是最终结果的下界，超过 maxDist 即可提前结束
+ */
+int EditDistance::dynamic(const u32string &text, int maxDist) const
+{
+    thread_local vector<int> column;
+    size_t m = _pattern.size();
+    column.resize(m + 1);
+    for (size_t i = 0; i <= m; ++i)
+        column[i] = i;
+
+    for (size_t j = 1; j <= text.size(); ++j)
+    {
+        int diagonal = column[0]; // D[i-1][j-1]
+        column[0] = j;
+        int columnMin = column[0];
+        for (size_t i = 1; i <= m; ++i)
+        {
+            int above = column[i]; // D[i][j-1]
+            int cost = _pattern[i - 1] == text[j - 1] ? 0 : 1;
+            column[i] = std::min({above + 1, column[i - 1] + 1, diagonal + cost});
+            diagonal = above;
+            columnMin = std::min(columnMin, column[i]);
+        }
+        if (columnMin > maxDist)
+            return maxDist + 1;
+    }
+    return std::min(column[m], maxDist + 1);
+}
+}; // namespace wdcpp
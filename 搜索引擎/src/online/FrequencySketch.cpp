@@ -0,0 +1,85 @@
+#include "FrequencySketch.h"
+
+#include <algorithm>
+
+namespace wdcpp
+{
+/**
+ *  capacity 为 0 时不分配计数器（不使用 TinyLFU 的 cache）
+ */
+FrequencySketch::FrequencySketch(size_t capacity)
+    : _mask(0),
+      _additions(0),
+      _sampleSize(0)
+{
+    if (capacity == 0)
+        return;
+
+    size_t width = 16;
+    while (width < capacity)
+        width <<= 1;
+    _table.assign(width * DEPTH, 0);
+    _mask = width - 1;
+    _sampleSize = width * 10;
+}
+
+/**
+ *  第 row 行中 hash 对应的计数器下标（每行用不同的种子再次混合，使各行相互独立）
+ */
+size_t FrequencySketch::indexOf(size_t hash, size_t row) const
+{
+    static const uint64_t SEEDS[DEPTH] = {0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+                                          0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+    uint64_t mixed = ((uint64_t)hash + SEEDS[row]) * 0x9e3779b97f4a7c15ULL;
+    mixed ^= mixed >> 32;
+    return row * (_mask + 1) + (mixed & _mask);
+}
+
+void FrequencySketch::increment(size_t hash)
+{
+    if (_table.empty())
+        return;
+
+    size_t indexes[DEPTH];
+    uint8_t minCount = MAX_COUNT;
+    for (size_t row = 0; row < DEPTH; ++row)
+    {
+        indexes[row] = indexOf(hash, row);
+        minCount = std::min(minCount, _table[indexes[row]]);
+    }
+    if (minCount == MAX_COUNT)
+        return;
+
+    for (size_t row = 0; row < DEPTH; ++row)
+    {
+        if (_table[indexes[row]] == minCount)
+            ++_table[indexes[row]];
+    }
+    if (++_additions >= _sampleSize)
+        age();
+}
+
+uint32_t FrequencySketch::frequency(size_t hash) const
+{
+    if (_table.empty())
+        return 0;
+
+    uint8_t minCount = MAX_COUNT;
+    for (size_t row = 0; row < DEPTH; ++row)
+        minCount = std::min(minCount, _table[indexOf(hash, row)]);
+    return minCount;
+}
+
+void FrequencySketch::age()
+{
+    for (auto &count : _table)
+        count >>= 1;
+    _additions /= 2;
+}
+
+void FrequencySketch::clear()
+{
+    std::fill(_table.begin(), _table.end(), 0);
+    _additions = 0;
+}
+}; // namespace wdcpp
@@ -0,0 +1,187 @@
+#include "IntersectionCache.h"
+#include "MutexLockGuard.h"
+#include "Configuration.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace wdcpp
+{
+IntersectionCache *IntersectionCache::_pInstance = IntersectionCache::getInstance(); // 饿汉
+
+IntersectionCache *IntersectionCache::getInstance()
+{
+    if (_pInstance == nullptr)
+    {
+        _pInstance = new IntersectionCache();
+        atexit(destroy);
+    }
+    return _pInstance;
+}
+
+IntersectionCache::IntersectionCache()
+    : _capacityPerShard(Configuration::getInstance()->getNumber("intersectioncachenum", 10000) / SHARD_NUM + 1),
+      _hits(0),
+      _misses(0)
+{
+}
+
+void IntersectionCache::destroy()
+{
+    using namespace std;
+    cout << "void IntersectionCache::destroy()" << endl;
+    if (_pInstance)
+    {
+        delete _pInstance;
+        _pInstance = nullptr;
+    }
+}
+
+uint64_t IntersectionCache::keyOf(TermID lhsID, TermID rhsID)
+{
+    return ((uint64_t)std::min(lhsID, rhsID) << 32) | std::max(lhsID, rhsID);
+}
+
+/**
+ *  取出键为 key 的已知前缀（版本号不同视为未命中，返回空指针）
+ */
+IntersectionCache::PrefixPtr IntersectionCache::lookup(uint64_t key, uint64_t generation)
+{
+    Shard &shard = _shards[std::hash<uint64_t>()(key) % SHARD_NUM];
+    MutexLockGuard autolock(shard.mutex);
+    auto it = shard.hashMap.find(key);
+    if (it == shard.hashMap.end() || it->second->generation != generation)
+    {
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second); // 移至头部
+    _hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second->prefix;
+}
+
+/**
+ *  写回前缀：已有同版本的记录且不比 prefix 短时保留原记录（并发求交时取较长者）
+ */
+void IntersectionCache::store(uint64_t key, uint64_t generation, const PrefixPtr &prefix)
+{
+    Shard &shard = _shards[std::hash<uint64_t>()(key) % SHARD_NUM];
+    MutexLockGuard autolock(shard.mutex);
+    auto it = shard.hashMap.find(key);
+    if (it != shard.hashMap.end())
+    {
+        const PrefixPtr &old = it->second->prefix;
+        if (it->second->generation == generation && (old->complete || (!prefix->complete && old->bound >= prefix->bound)))
+            return;
+        it->second->generation = generation;
+        it->second->prefix = prefix;
+        shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second);
+        return;
+    }
+
+    shard.entryList.push_front({key, generation, prefix});
+    shard.hashMap[key] = shard.entryList.begin();
+    if (shard.entryList.size() > _capacityPerShard) // 已满，淘汰最久未访问的记录
+    {
+        shard.hashMap.erase(shard.entryList.back().key);
+        shard.entryList.pop_back();
+    }
+}
+
+uint64_t IntersectionCache::getHits() const
+{
+    return _hits.load(std::memory_order_relaxed);
+}
+
+uint64_t IntersectionCache::getMisses() const
+{
+    return _misses.load(std::memory_order_relaxed);
+}
+
+/**
+ *  取得 lhs 与 rhs（均为升序的 docid）交集的缓存前缀，并定位到前缀之后接着求交的位置
+ */
+IntersectionCursor::IntersectionCursor(TermID lhsID, const vector<PageID> &lhs,
+                                       TermID rhsID, const vector<PageID> &rhs, uint64_t generation)
+    : _shorter(lhs.size() <= rhs.size() ? lhs : rhs),
+      _longer(lhs.size() <= rhs.size() ? rhs : lhs),
+      _key(IntersectionCache::keyOf(lhsID, rhsID)),
+      _generation(generation),
+      _cached(IntersectionCache::getInstance()->lookup(_key, generation)),
+      _cachedPos(0),
+      _shorterPos(0),
+      _low(_longer.begin()),
+      _bound(std::numeric_limits<PageID>::min()),
+      _complete(false)
+{
+    if (_cached)
+    {
+        _bound = _cached->bound;
+        _complete = _cached->complete;
+        if (!_complete)
+        {
+            _shorterPos = std::lower_bound(_shorter.begin(), _shorter.end(), _bound) - _shorter.begin();
+            _low = std::lower_bound(_longer.begin(), _longer.end(), _bound);
+        }
+    }
+}
+
+/**
+ *  本次求出了更多的交集时，写回更长的前缀
+ */
+IntersectionCursor::~IntersectionCursor()
+{
+    bool isExtended = _cached ? (_complete != _cached->complete || _bound != _cached->bound) : (_complete || _shorterPos > 0);
+    if (!isExtended)
+        return;
+
+    auto prefix = std::make_shared<IntersectionPrefix>();
+    prefix->IDs.reserve((_cached ? _cached->IDs.size() : 0) + _extension.size());
+    if (_cached)
+        prefix->IDs = _cached->IDs;
+    prefix->IDs.insert(prefix->IDs.end(), _extension.begin(), _extension.end());
+    prefix->bound = _bound;
+    prefix->complete = _complete;
+    IntersectionCache::getInstance()->store(_key, _generation, prefix);
+}
+
+/**
+ *  给出交集的下一个 docid
+ *
+ *  1. 每处理 _shorter 中的一个元素（无论是否在交集中），bound 前进到它之后
+ */
+bool IntersectionCursor::next(PageID &id)
+{
+    if (_cached && _cachedPos < _cached->IDs.size())
+    {
+        id = _cached->IDs[_cachedPos++];
+        return true;
+    }
+
+    while (!_complete && _shorterPos < _shorter.size())
+    {
+        PageID candidate = _shorter[_shorterPos++];
+        _bound = candidate + 1;
+        auto high = _low; // 查找区间 [low, high]，*low < candidate
+        for (size_t step = 1; high != _longer.end() && *high < candidate; step <<= 1)
+        {
+            _low = high;
+            high = (size_t)(_longer.end() - high) > step ? high + step : _longer.end();
+        }
+        _low = std::lower_bound(_low, high, candidate);
+        if (_low == _longer.end()) // 较长的列表已用完
+            break;
+        if (*_low == candidate)
+        {
+            ++_low;
+            _extension.push_back(candidate);
+            id = candidate;
+            return true;
+        }
+    }
+    _complete = true;
+    return false;
+}
+}; // namespace wdcpp
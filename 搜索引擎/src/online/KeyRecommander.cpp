@@ -1,14 +1,8 @@
 #include "KeyRecommander.h"
 #include "Configuration.h"
 #include "MyLog.h"
-#include "nlohmann/json.hpp"
-#include "fifo_map.hpp"
-using namespace nlohmann;
-/* 以下为 nlohmann/json 库使用，保证插入顺序不变 */
-template <class K, class V, class dummy_compare, class A>
-using my_workaround_fifo_map = fifo_map<K, V, fifo_map_compare<K>, A>;
-using my_json = basic_json<my_workaround_fifo_map>;
-using Json = my_json;
+#include "JsonWriter.h"
+#include "MultiBytesCharacter.h"
 
 #include <algorithm>
 #include <iostream>
@@ -16,178 +10,264 @@ using std::cout;
 using std::endl;
 using namespace wdcpp;
 
-string KeyRecommander::doQuery(const string &queWord)
+KeyRecommander::KeyRecommander()
+    : _prettyJson(Configuration::getInstance()->getNumber("prettyjson", 0) != 0),
+      _maxKeyDist(Configuration::getInstance()->getNumber("maxkeydist", 2)),
+      _maxKeyNum(Configuration::getInstance()->getNumber("maxkeynum", 10))
 {
-    Dictionary *pdict = Dictionary::getInstance();//得到字典和索引
-    const map<string, set<int>> &indexTable = pdict->getIndexTable(); // 词典索引
+}
 
-    set<int> indexId; //获得的索引ID
-    string index;
-    for (size_t idx = 0; idx < queWord.length(); ++idx)
-    {
-        size_t nBytes = nBytesCode(queWord[idx]);
-        index = queWord.substr(idx, nBytes);
-        idx += (nBytes - 1);
-        auto it = indexTable.find(index);
-        if (it != indexTable.end())
-        {
-            indexId.insert(it->second.begin(), it->second.end());
-        }
-    }
+string KeyRecommander::doQuery(const string &queWord, WireFormat format)
+{
+    u32string query = decodeUtf8(queWord);
+    vector<int> indexId = getCandidates(query); //获得的候选词ID
 
     if (indexId.size() == 0)
     {
         LogInfo("\n\tkeyRecommender miss: %s", queWord.c_str());
-        return serializeForNoting();
+        return serializeForNoting(format);
     }
 
-    priority_queue<MyResult, vector<MyResult>, MyCompare> resultQue;
-    statistic(queWord, indexId, resultQue);//resultQue存放的是 单词 频率和距离
-
     vector<string> result;
-    const int candicateCount = stoi(Configuration::getInstance()->getConfigMap()["maxkeynum"]);
-    for (int i = 0; i < candicateCount; ++i)
+    for (auto &elem : statistic(EditDistance(query), indexId))
     {
-        if (!resultQue.empty())
-        {
 #ifdef __DEBUG__
-            cout << resultQue.top().getWord() << endl;
+        cout << elem.getWord() << endl;
 #endif
-            result.push_back(resultQue.top().getWord());
-            resultQue.pop();
-        }
+        result.push_back(elem.getWord());
     }
 
-    return serialize(result);
+    return serialize(result, format);
 }
 
-void KeyRecommander::statistic(const string &queWord,
-                               set<int> &indexId,
-                               priority_queue<MyResult, vector<MyResult>, MyCompare> &resultQue)
+/**
+ *  前缀补全：直接取出前缀结点上预先计算的补全（按词频降序），不计算编辑距离
+ */
+string KeyRecommander::doComplete(const string &prefix, WireFormat format)
 {
     Dictionary *pdict = Dictionary::getInstance();
-    const vector<pair<string, int>> &dict = pdict->getDict(); // 词典
+    const CompletionTrie &trie = pdict->getCompletionTrie();
+    const vector<pair<string, int>> &dict = pdict->getDict();
 
-    for (auto it = indexId.begin(); it != indexId.end(); ++it)
+    vector<uint32_t> ids;
+    if (!trie.available() || !trie.complete(prefix, ids) || ids.empty())
     {
-        MyResult result(dict[*it].first, dict[*it].second);
-        int dist = distance(queWord, dict[*it].first);
-        result.setDist(dist);
-        resultQue.push(result);
+        LogInfo("\n\tcompletion miss: %s", prefix.c_str());
+        return serializeForNoting(format);
     }
-}
-size_t KeyRecommander::nBytesCode(const char ch)
-{
-    if (ch & (1 << 7))
-    {
 
-        int nBytes = 1;
-        for (int idx = 0; idx != 6; ++idx)
-        {
-            if (ch & (1 << (6 - idx)))
-            {
-                ++nBytes;
-            }
-            else
-                break;
-        }
-        return nBytes;
-    }
-    return 1;
-}
-std::size_t KeyRecommander::length(const std::string &str)
-{
-    std::size_t ilen = 0;
-    for (std::size_t idx = 0; idx != str.size(); ++idx)
+    vector<string> result;
+    for (uint32_t id : ids)
     {
-        int nBytes = nBytesCode(str[idx]);
-        idx += (nBytes - 1);
-        ++ilen;
+        if (id < dict.size())
+            result.push_back(dict[id].first);
     }
-    return ilen;
+    return serialize(result, format);
 }
 
-int KeyRecommander::triple_min(const int &a, const int &b, const int &c)
+/**
+ *  生成候选词：删除变体索引可用且覆盖 _maxKeyDist 时直接查表，否则做二元组计数过滤
+ */
+vector<int> KeyRecommander::getCandidates(const u32string &query)
 {
-    return a < b ? (a < c ? a : c) : (b < c ? b : c);
+    const DeletionIndex &deletionIndex = Dictionary::getInstance()->getDeletionIndex();
+    if (deletionIndex.available() && _maxKeyDist <= deletionIndex.maxDist())
+        return getCandidatesByDeletes(query, deletionIndex);
+    return getCandidatesByGrams(query);
 }
 
-int KeyRecommander::distance(const string &lhs, const string &rhs)
+/**
+ *  由删除变体索引生成候选词（SymSpell）
+ *
+ *  1. 关键词删除至多 _maxKeyDist 个字符的每个变体查一次表，得到的词编号合并去重
+ *  2. 结果包含所有编辑距离不超过 _maxKeyDist 的词（另有少量哈希冲突或距离更大的词，
+ *     由 statistic 中的编辑距离校验剔除）
+ */
+vector<int> KeyRecommander::getCandidatesByDeletes(const u32string &query, const DeletionIndex &deletionIndex)
 {
-    if (lhs == rhs) //相等返回0
-        return 0;
-
-    //计算最小编辑距离-包括处理中英文
-    size_t lhs_len = length(lhs);
-    size_t rhs_len = length(rhs);
-    int editDist[lhs_len + 1][rhs_len + 1];
-    for (size_t idx = 0; idx <= lhs_len; ++idx)
+    const vector<u32string> &codepoints = Dictionary::getInstance()->getCodepoints();
+
+    thread_local vector<uint32_t> ids; // 本线程复用
+    ids.clear();
+    for (uint64_t hash : deletionHashes(query, _maxKeyDist))
+        deletionIndex.lookup(hash, ids);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    vector<int> candidates;
+    for (uint32_t id : ids)
     {
-        editDist[idx][0] = idx;
+        if (id < codepoints.size()) // 索引与词典不匹配时忽略越界的编号
+            candidates.push_back(id);
     }
+    return candidates;
+}
+
+/**
+ *  由二元组索引生成候选词（q-gram 计数过滤）
+ *
+ *  1. 统计每个词与查询词共有的二元组个数（按多重集合计：每个二元组取两边出现次数的较小值）
+ *  2. 编辑距离不超过 _maxKeyDist 的词，长度差不超过 _maxKeyDist，且共有的二元组
+ *     不少于 max(Lq, Lt) + 1 - 2 * _maxKeyDist 个；阈值不足 1 时仍要求至少共有 1 个，
+ *     以免短关键词把整个词典都当作候选词
+ *  3. 计数数组由本线程复用，只清零访问过的词
+ */
+vector<int> KeyRecommander::getCandidatesByGrams(const u32string &query)
+{
+    Dictionary *pdict = Dictionary::getInstance();
+    const unordered_map<uint64_t, vector<int>> &gramIndex = pdict->getGramIndex();
+    const vector<u32string> &codepoints = pdict->getCodepoints();
 
-    for (size_t idx = 0; idx <= rhs_len; ++idx)
+    unordered_map<uint64_t, size_t> queryGrams; // <二元组, 在关键词中的出现次数>
+    char32_t prev = Dictionary::GRAM_PAD;
+    for (char32_t ch : query)
     {
-        editDist[0][idx] = idx;
+        ++queryGrams[Dictionary::gramKey(prev, ch)];
+        prev = ch;
     }
+    ++queryGrams[Dictionary::gramKey(prev, Dictionary::GRAM_PAD)];
 
-    string sublhs, subrhs;
+    thread_local vector<uint16_t> counts; // 下标为词编号
+    thread_local vector<int> touched;     // 计数不为 0 的词
+    counts.resize(codepoints.size(), 0);
+    touched.clear();
 
-    for (std::size_t dist_i = 1, lhs_idx = 0; dist_i <= lhs_len; ++dist_i, ++lhs_idx)
+    size_t queryLength = query.size();
+    for (auto &gram : queryGrams)
     {
-        size_t nBytes = nBytesCode(lhs[lhs_idx]);
-        sublhs = lhs.substr(lhs_idx, nBytes);
-        lhs_idx += (nBytes - 1);
+        auto it = gramIndex.find(gram.first);
+        if (it == gramIndex.end())
+            continue;
 
-        for (std::size_t dist_j = 1, rhs_idx = 0; dist_j <= rhs_len; ++dist_j, ++rhs_idx)
+        const vector<int> &ids = it->second;
+        for (size_t beg = 0, end = 0; beg < ids.size(); beg = end)
         {
-            nBytes = nBytesCode(rhs[rhs_idx]);
-            subrhs = rhs.substr(rhs_idx, nBytes);
-            rhs_idx += (nBytes - 1);
-            if (sublhs == subrhs)
-            {
-                editDist[dist_i][dist_j] = editDist[dist_i - 1][dist_j - 1];
-            }
-            else
-            {
-                editDist[dist_i][dist_j] = triple_min(
-                    editDist[dist_i][dist_j - 1] + 1,
-                    editDist[dist_i - 1][dist_j] + 1,
-                    editDist[dist_i - 1][dist_j - 1] + 1);
-            }
+            int id = ids[beg];
+            for (end = beg + 1; end < ids.size() && ids[end] == id; ++end) // 同一个词中重复的二元组相邻
+                ;
+            size_t length = codepoints[id].size();
+            if ((length > queryLength ? length - queryLength : queryLength - length) > (size_t)_maxKeyDist) // 长度过滤
+                continue;
+            if (counts[id] == 0)
+                touched.push_back(id);
+            counts[id] += std::min(end - beg, gram.second);
         }
     }
-    return editDist[lhs_len][rhs_len];
+
+    vector<int> candidates;
+    for (int id : touched)
+    {
+        int required = (int)std::max(queryLength, codepoints[id].size()) + 1 - 2 * _maxKeyDist;
+        if (counts[id] >= std::max(required, 1))
+            candidates.push_back(id);
+        counts[id] = 0;
+    }
+    return candidates;
+}
+
+/**
+ *  计算候选词与查询词的编辑距离，选出最好的 _maxKeyNum 个结果（按 MyCompare 排序）
+ *
+ *  1. 查询词只预处理一次，候选词使用词典中预先解码的码点，比较时不分配内存
+ *  2. 有界堆只保留 k 个结果，结果只引用词典中的词；堆满后以堆顶（第 k 名）的
+ *     距离为上界：长度差超过上界的候选词不计算距离，距离计算超过上界即提前结束
+ *  3. 编辑距离超过 _maxKeyDist 的候选词（通过了过滤，但并不相近）不推荐
+ *  4. 在当前工作线程中完成打分：经长度与二元组过滤后候选词很少，
+ *     并发由 ThreadPool 在请求之间提供
+ */
+vector<MyResult> KeyRecommander::statistic(const EditDistance &queWord, const vector<int> &indexId)
+{
+    Dictionary *pdict = Dictionary::getInstance();
+    const vector<pair<string, int>> &dict = pdict->getDict(); // 词典
+    const vector<u32string> &codepoints = pdict->getCodepoints();
+
+    TopKHeap topK;
+    size_t queryLength = queWord.size();
+    for (int id : indexId)
+    {
+        int bound = topK.size() >= _maxKeyNum ? topK.top().getDist() : _maxKeyDist;
+        size_t length = codepoints[id].size();
+        if ((length > queryLength ? length - queryLength : queryLength - length) > (size_t)bound) // 距离不小于长度差
+            continue;
+        int dist = queWord.distance(codepoints[id], bound);
+        if (dist > bound)
+            continue;
+
+        pushTopK(topK, MyResult(dict[id].first, dict[id].second, dist));
+    }
+
+    vector<MyResult> results;
+    results.reserve(topK.size());
+    for (; !topK.empty(); topK.pop()) // 先出堆的是较差的结果
+        results.push_back(topK.top());
+    std::reverse(results.begin(), results.end());
+    return results;
+}
+
+/**
+ *  放入有界堆：未满直接放入，已满时只有优于堆顶（第 k 名）才替换堆顶
+ */
+void KeyRecommander::pushTopK(TopKHeap &topK, const MyResult &result)
+{
+    if (_maxKeyNum == 0)
+        return;
+    if (topK.size() < _maxKeyNum)
+        topK.push(result);
+    else if (MyCompare()(topK.top(), result))
+    {
+        topK.pop();
+        topK.push(result);
+    }
 }
 
 /**
  *  未找到结果，返回 404 序列化结果
  */
-string KeyRecommander::serializeForNoting()
+string KeyRecommander::serializeForNoting(WireFormat format)
 {
-    Json root;
-    root["msgID"] = 404;
-    root["msg"] = json("未能找到相关关键词");
-    // root["msg"] = "未能找到相关关键词"; // 一样的效果
+    string response;
+    if (format == WireFormat::Binary)
+    {
+        BinaryWriter writer(response);
+        writer.putU16(404).putU8(false).putString("未能找到相关关键词");
+        return response;
+    }
 
-    return root.dump(4);
+    JsonWriter writer(response, _prettyJson);
+    writer.beginObject()
+        .key("msgID").value(404)
+        .key("msg").value("未能找到相关关键词")
+        .endObject();
+    return response;
 }
 
 /**
  *  找到结果，返回所有关键词的序列化结果
  */
-string KeyRecommander::serialize(const vector<string> &result)
+string KeyRecommander::serialize(const vector<string> &result, WireFormat format)
 {
-    Json root;
-    root["msgID"] = 100;
+    string response;
+    if (format == WireFormat::Binary)
+    {
+        BinaryWriter writer(response);
+        writer.putU16(100).putU32(result.size());
+        for (auto &word : result)
+            writer.putString(word);
+        return response;
+    }
 
-    Json msg = result;
-    root["msg"] = msg;
+    JsonWriter writer(response, _prettyJson);
+    writer.beginObject()
+        .key("msgID").value(100)
+        .key("msg").beginArray();
+    for (auto &word : result)
+        writer.value(word);
+    writer.endArray().endObject();
 
 #ifdef __DEBUG__
     printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-    cout << root.dump(4) << endl;
+    cout << response << endl;
 #endif
 
-    return root.dump(4);
-}
\ No newline at end of file
+    return response;
+}
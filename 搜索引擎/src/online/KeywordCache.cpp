@@ -0,0 +1,129 @@
+#include "KeywordCache.h"
+#include "MutexLockGuard.h"
+#include "Configuration.h"
+
+#include <iostream>
+
+namespace wdcpp
+{
+KeywordCache *KeywordCache::_pInstance = KeywordCache::getInstance(); // 饿汉
+
+KeywordCache *KeywordCache::getInstance()
+{
+    if (_pInstance == nullptr)
+    {
+        _pInstance = new KeywordCache();
+        atexit(destroy);
+    }
+    return _pInstance;
+}
+
+KeywordCache::KeywordCache()
+    : _capacityPerShard(Configuration::getInstance()->getNumber("keywordcachenum", 10000) / SHARD_NUM + 1),
+      _ttl(Configuration::getInstance()->getNumber("keywordttl", 60)),
+      _hits(0),
+      _misses(0),
+      _redisHits(0),
+      _redisMisses(0)
+{
+}
+
+void KeywordCache::destroy()
+{
+    using namespace std;
+    cout << "void KeywordCache::destroy()" << endl;
+    if (_pInstance)
+    {
+        delete _pInstance;
+        _pInstance = nullptr;
+    }
+}
+
+/**
+ *  查询一级缓存，命中且未过期时将结果写入 value 并返回 true
+ */
+bool KeywordCache::get(const string &key, string &value)
+{
+    Shard &shard = _shards[std::hash<string>()(key) % SHARD_NUM];
+    {
+        MutexLockGuard autolock(shard.mutex);
+        auto it = shard.hashMap.find(key);
+        if (it != shard.hashMap.end())
+        {
+            if (it->second->expireAt > Clock::now())
+            {
+                shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second); // 移至头部
+                value = it->second->value;
+                _hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            shard.entryList.erase(it->second); // 已过期
+            shard.hashMap.erase(it);
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/**
+ *  存入一级缓存（已存在则覆盖并重新计时）
+ */
+void KeywordCache::put(const string &key, const string &value)
+{
+    Clock::time_point expireAt = Clock::now() + std::chrono::seconds(_ttl);
+    Shard &shard = _shards[std::hash<string>()(key) % SHARD_NUM];
+    MutexLockGuard autolock(shard.mutex);
+    auto it = shard.hashMap.find(key);
+    if (it != shard.hashMap.end())
+    {
+        it->second->value = value;
+        it->second->expireAt = expireAt;
+        shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second);
+        return;
+    }
+
+    shard.entryList.push_front({key, value, expireAt});
+    shard.hashMap[key] = shard.entryList.begin();
+    if (shard.entryList.size() > _capacityPerShard) // 已满，淘汰最久未访问的记录
+    {
+        shard.hashMap.erase(shard.entryList.back().key);
+        shard.entryList.pop_back();
+    }
+}
+
+/**
+ *  记录的有效期（秒），redis 中的记录使用相同的有效期
+ */
+size_t KeywordCache::getTTL() const
+{
+    return _ttl;
+}
+
+/**
+ *  记录一次二级缓存（redis）查询的结果
+ */
+void KeywordCache::recordRedis(bool hit)
+{
+    (hit ? _redisHits : _redisMisses).fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t KeywordCache::getHits() const
+{
+    return _hits.load(std::memory_order_relaxed);
+}
+
+uint64_t KeywordCache::getMisses() const
+{
+    return _misses.load(std::memory_order_relaxed);
+}
+
+uint64_t KeywordCache::getRedisHits() const
+{
+    return _redisHits.load(std::memory_order_relaxed);
+}
+
+uint64_t KeywordCache::getRedisMisses() const
+{
+    return _redisMisses.load(std::memory_order_relaxed);
+}
+}; // namespace wdcpp
@@ -1,111 +1,390 @@
 #include "LRUCache.h"
-#include "Thread.h"
 
-#include <iostream>
-#include <fstream>
-#include <sstream>
-using std::ifstream;
-using std::istringstream;
-using std::ofstream;
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#include <algorithm>
 
 namespace wdcpp
 {
-extern __thread size_t __thread_id; // 工作线程的编号（0, 1, 2, ... , _workerNum-1）
+LRUCache::LRUCache(size_t capacity, const CacheOptions &options)
+    : _entries(capacity),
+      _mask(0),
+      _size(0),
+      _capacity(capacity),
+      _bytes(0),
+      _byteBudget(options.byteBudget),
+      _compressBytes(options.compressBytes),
+      _policy(options.policy),
+      _windowCapacity(capacity),
+      _protectedCapacity(0),
+      _sketch(options.policy == CachePolicy::TinyLfu ? capacity : 0)
+{
+    _freeSlots.reserve(capacity);
+    for (size_t idx = capacity; idx-- > 0;) // 从 0 号记录槽开始使用
+        _freeSlots.push_back(idx);
+
+    size_t indexSize = 1;
+    while (indexSize < capacity * 2) // 装载因子不超过 1/2
+        indexSize <<= 1;
+    _index.assign(indexSize, NIL);
+    _mask = indexSize - 1;
+
+    for (int segment = 0; segment < SEGMENT_NUM; ++segment)
+    {
+        _head[segment] = _tail[segment] = NIL;
+        _segmentSize[segment] = 0;
+    }
+    if (_policy == CachePolicy::TinyLfu)
+    {
+        _windowCapacity = std::min(std::max<size_t>(capacity / 100, 1), capacity);
+        _protectedCapacity = (capacity - _windowCapacity) * 4 / 5;
+    }
+}
 
-LRUCache::LRUCache(size_t capacity)
-    : _capacity(capacity)
+/**
+ *  查找 query 在 _index 中的位置：命中时为其所在槽，否则为探测到的空槽
+ */
+size_t LRUCache::probe(const string &query, size_t hash) const
 {
+    size_t pos = hash & _mask;
+    while (_index[pos] != NIL)
+    {
+        const Entry &entry = _entries[_index[pos]];
+        if (entry.hash == hash && entry.key == query)
+            break;
+        pos = (pos + 1) & _mask;
+    }
+    return pos;
 }
 
-bool LRUCache::isHit(const string &query)
+bool LRUCache::isHit(const string &query) const
 {
-    return _hashMap.count(query) > 0;
+    return _index[probe(query, std::hash<string>()(query))] != NIL;
 }
 
-string LRUCache::getRecord(const string &query)
+LRUCache::Value LRUCache::getRecord(const string &query)
 {
-    if (!isHit(query))
-        return "";
-    std::cout << "No." << __thread_id << " cache hit!" << std::endl;
-    // 将 query 的记录移至 _resultList 头部
-    _resultList.splice(_resultList.begin(), _resultList, _hashMap[query]);
-    return _hashMap[query]->second;
+    return getRecord(query, std::hash<string>()(query));
+}
+
+LRUCache::Value LRUCache::getRecord(const string &query, size_t hash)
+{
+    if (_policy == CachePolicy::TinyLfu) // 未命中的访问也计入频率
+        _sketch.increment(hash);
+
+    uint32_t idx = _index[probe(query, hash)];
+    if (idx == NIL)
+        return nullptr;
+    touch(idx);
+    return unpack(_entries[idx]); // 解压失败（数据损坏）时返回空指针，按未命中处理
 }
 
 void LRUCache::insertRecord(const string &query, const string &result)
 {
-    if (isHit(query))
+    insertRecord(query, std::make_shared<const string>(result));
+}
+
+void LRUCache::insertRecord(const string &query, const Value &result, uint32_t cost)
+{
+    insertRecord(query, result, cost, std::hash<string>()(query));
+}
+
+void LRUCache::insertRecord(const string &query, const Value &result, uint32_t cost, size_t hash)
+{
+    if (_capacity == 0)
+        return;
+
+    uint32_t rawSize = 0;
+    Value stored = pack(result, rawSize);
+    size_t pos = probe(query, hash);
+    uint32_t idx = _index[pos];
+    if (_byteBudget != 0 && sizeof(Entry) + query.size() + stored->size() > _byteBudget) // 单条记录超出预算，不缓存
+    {
+        if (idx != NIL) // 删除已有的旧结果，避免继续返回过期的记录
+        {
+            eraseIndex(idx);
+            unlink(idx);
+            _bytes -= charge(idx);
+            --_size;
+            release(idx);
+            _freeSlots.push_back(idx);
+        }
+        return;
+    }
+
+    if (idx != NIL)
+    {
+        Entry &entry = _entries[idx];
+        _bytes -= charge(idx);
+        entry.value = std::move(stored);
+        entry.rawSize = rawSize;
+        entry.cost = cost;
+        _bytes += charge(idx);
+        touch(idx);
+        shrink();
+        return;
+    }
+
+    if (!_freeSlots.empty()) // 还有空闲的记录槽
+    {
+        idx = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        // 已满：先腾出一个记录槽（删除会移动 _index 中的元素，需重新探测）
+        idx = evict();
+        pos = probe(query, hash);
+    }
+
+    Entry &entry = _entries[idx];
+    entry.key = query;
+    entry.value = std::move(stored);
+    entry.rawSize = rawSize;
+    entry.hash = hash;
+    entry.cost = cost;
+    _index[pos] = idx;
+    pushFront(idx, WINDOW);
+    ++_size;
+    _bytes += charge(idx);
+    if (_segmentSize[WINDOW] > _windowCapacity) // 未满时窗口溢出的记录直接进入试用段
+    {
+        uint32_t overflow = _tail[WINDOW];
+        unlink(overflow);
+        pushFront(overflow, PROBATION);
+    }
+    shrink();
+}
+
+/**
+ *  超出字节预算时按淘汰策略淘汰记录，直到不超出（至少保留一条）
+ */
+void LRUCache::shrink()
+{
+    while (_byteBudget != 0 && _bytes > _byteBudget && _size > 1)
+    {
+        uint32_t idx = evict();
+        release(idx);
+        _freeSlots.push_back(idx);
+    }
+}
+
+/**
+ *  释放记录槽中的键与结果（记录槽本身保留）
+ */
+void LRUCache::release(uint32_t idx)
+{
+    string().swap(_entries[idx].key);
+    _entries[idx].value.reset();
+}
+
+/**
+ *  一条记录计入预算的字节数：记录槽、索引槽（装载因子 1/2，每条约两个）、键与存放的结果
+ */
+size_t LRUCache::charge(uint32_t idx) const
+{
+    const Entry &entry = _entries[idx];
+    return sizeof(Entry) + 2 * sizeof(uint32_t) + entry.key.size() + entry.value->size();
+}
+
+/**
+ *  按压缩阈值决定结果的存放形式，压缩时 rawSize 为压缩前的长度
+ */
+LRUCache::Value LRUCache::pack(const Value &result, uint32_t &rawSize) const
+{
+    rawSize = 0;
+#ifndef USE_LZ4
+    return result;
+#else
+    if (_compressBytes == 0 || result->size() < _compressBytes || result->size() > (size_t)LZ4_MAX_INPUT_SIZE)
+        return result;
+
+    string compressed(LZ4_compressBound(result->size()), '\0');
+    int length = LZ4_compress_default(result->data(), &compressed[0], result->size(), compressed.size());
+    if (length <= 0 || (size_t)length >= result->size()) // 压缩后没有变小
+        return result;
+    compressed.resize(length);
+    compressed.shrink_to_fit();
+    rawSize = result->size();
+    return std::make_shared<const string>(std::move(compressed));
+#endif
+}
+
+/**
+ *  取出记录的结果：未压缩时直接返回存放的结果，否则解压出一份新的结果
+ */
+LRUCache::Value LRUCache::unpack(const Entry &entry) const
+{
+    if (entry.rawSize == 0)
+        return entry.value;
+
+#ifndef USE_LZ4
+    return nullptr; // 不会出现：未启用 LZ4 时不压缩
+#else
+    string raw(entry.rawSize, '\0');
+    int length = LZ4_decompress_safe(entry.value->data(), &raw[0], entry.value->size(), raw.size());
+    if (length != (int)entry.rawSize)
+        return nullptr;
+    return std::make_shared<const string>(std::move(raw));
+#endif
+}
+
+/**
+ *  命中：移至所在段的头部；试用段中的记录升入保护段
+ */
+void LRUCache::touch(uint32_t idx)
+{
+    if (_entries[idx].segment != PROBATION)
+    {
+        int segment = _entries[idx].segment;
+        unlink(idx);
+        pushFront(idx, segment);
+        return;
+    }
+
+    unlink(idx);
+    pushFront(idx, PROTECTED);
+    if (_segmentSize[PROTECTED] > _protectedCapacity) // 保护段已满：尾部记录降回试用段
     {
-        // 将 query 的记录移至 _resultList 头部
-        _resultList.splice(_resultList.begin(), _resultList, _hashMap[query]);
+        uint32_t demoted = _tail[PROTECTED];
+        unlink(demoted);
+        pushFront(demoted, PROBATION);
+    }
+}
+
+/**
+ *  淘汰一条记录，返回腾出的记录槽
+ *
+ *  1. 窗口已满时，窗口尾部记录（候选者）与主区尾部记录（牺牲者）比较 score，
+ *     候选者更大才进入试用段并淘汰牺牲者，否则淘汰候选者
+ *  2. 窗口未满时淘汰主区尾部记录；LRU 策略下主区为空，即淘汰窗口尾部记录
+ */
+uint32_t LRUCache::evict()
+{
+    uint32_t candidate = _segmentSize[WINDOW] >= _windowCapacity ? _tail[WINDOW] : NIL;
+    uint32_t victim = _tail[PROBATION] != NIL ? _tail[PROBATION] : _tail[PROTECTED];
+    uint32_t evicted;
+    if (candidate == NIL)
+        evicted = victim != NIL ? victim : _tail[WINDOW];
+    else if (victim == NIL)
+        evicted = candidate;
+    else if (score(candidate) > score(victim))
+    {
+        unlink(candidate);
+        pushFront(candidate, PROBATION);
+        evicted = victim;
     }
     else
+        evicted = candidate;
+
+    eraseIndex(evicted);
+    unlink(evicted);
+    _bytes -= charge(evicted);
+    --_size;
+    return evicted;
+}
+
+/**
+ *  记录留在 cache 中的价值：估计的访问频率 × 开销权重
+ *
+ *  1. 开销权重为 4 + log2(开销毫秒数 + 1)（取整），1 秒的结果约为 1 毫秒以内结果的 3.5 倍，
+ *     频率仍起主要作用
+ */
+uint64_t LRUCache::score(uint32_t idx) const
+{
+    const Entry &entry = _entries[idx];
+    uint64_t weight = 4;
+    for (uint32_t ms = entry.cost / 1000; ms != 0; ms >>= 1)
+        ++weight;
+    return (uint64_t)_sketch.frequency(entry.hash) * weight;
+}
+
+/**
+ *  从 _index 中删除记录 idx，并将其后同一探测序列上的元素前移填补空位
+ */
+void LRUCache::eraseIndex(uint32_t idx)
+{
+    size_t hole = _entries[idx].hash & _mask;
+    while (_index[hole] != idx)
+        hole = (hole + 1) & _mask;
+
+    for (size_t pos = (hole + 1) & _mask; _index[pos] != NIL; pos = (pos + 1) & _mask)
     {
-        _resultList.push_front({ query, result}); // 将记录 <query, json> 插入 _resultList 头部
-        _hashMap[query] = _resultLis//*t.begin();   // 更新 _hashMap
-        if (_resultList.size() > _capacity)      // _resultList 已满
+        size_t home = _entries[_index[pos]].hash & _mask;
+        if (((pos - home) & _mask) >= ((pos - hole) & _mask)) // 空位在 home 到 pos 之间，可以前移
         {
-            auto back_key = _resultList.back().first; // 暂存尾部记录的 query
-            _resultList.pop_back();                   // 删除 _resultList 尾部记录
-            _hashMap.erase(back_key);                 // 更新 _hashMap
+            _index[hole] = _index[pos];
+            hole = pos;
         }
     }
+    _index[hole] = NIL;
 }
 
-// void LRUCache::load(const string &path)
-// {
-//     ifstream ifs(path);
-//     if (!ifs)
-//     {
-//         std::cout << "LRU cache file open failed" << std::endl;
-//     }
-
-//     string line;
-//     while (getline(ifs, line))
-//     {
-//         istringstream iss(line);
-//         string key, value;
-//         iss >> key >> value;
-//         insertRecord(key, value);
-//     }
-
-//     ifs.close();
-// }
-
-// void LRUCache::dump(const string &path)
-// {
-//     ofstream ofs(path);
-//     if (!ofs)
-//     {
-//         std::cout << "LRU cache file open failed" << std::endl;
-//     }
-
-//     auto it = _resultList.rbegin();
-//     int count = 0;
-//     for (; it != _resultList.rend(); ++it)
-//     {
-//         ofs << it->first << " " << it->second << std::endl;
-//     }
-
-//     ofs.close();
-// }
+void LRUCache::unlink(uint32_t idx)
+{
+    Entry &entry = _entries[idx];
+    if (entry.prev != NIL)
+        _entries[entry.prev].next = entry.next;
+    else
+        _head[entry.segment] = entry.next;
+    if (entry.next != NIL)
+        _entries[entry.next].prev = entry.prev;
+    else
+        _tail[entry.segment] = entry.prev;
+    --_segmentSize[entry.segment];
+}
 
-void LRUCache::clear()
+void LRUCache::pushFront(uint32_t idx, int segment)
 {
-    _resultList.clear();
-    _hashMap.clear();
+    Entry &entry = _entries[idx];
+    entry.segment = segment;
+    entry.prev = NIL;
+    entry.next = _head[segment];
+    if (_head[segment] != NIL)
+        _entries[_head[segment]].prev = idx;
+    else
+        _tail[segment] = idx;
+    _head[segment] = idx;
+    ++_segmentSize[segment];
 }
 
-void LRUCache::update(const LRUCache &cache)
+void LRUCache::clear()
 {
-    for (auto it = cache._resultList.rbegin(); it != cache._resultList.rend(); ++it)
+    _freeSlots.clear();
+    for (size_t idx = _capacity; idx-- > 0;) // 释放键与结果，记录槽保留
+    {
+        release(idx);
+        _freeSlots.push_back(idx);
+    }
+    std::fill(_index.begin(), _index.end(), NIL);
+    for (int segment = 0; segment < SEGMENT_NUM; ++segment)
     {
-        insertRecord(it->first, it->second);
+        _head[segment] = _tail[segment] = NIL;
+        _segmentSize[segment] = 0;
     }
+    _size = 0;
+    _bytes = 0;
+    _sketch.clear();
+}
+
+/**
+ *  按从旧到新的顺序插入 cache 的记录（结果共享，不复制）
+ */
+void LRUCache::update(const LRUCache &cache)
+{
+    cache.forEach([this](const string &query, const Value &result, uint32_t cost) {
+        insertRecord(query, result, cost);
+    });
 }
 
 size_t LRUCache::size() const
 {
-    return _resultList.size();
+    return _size;
+}
+
+size_t LRUCache::bytes() const
+{
+    return _bytes;
 }
 }; // namespace wdcpp
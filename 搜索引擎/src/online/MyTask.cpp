@@ -1,6 +1,9 @@
 #include "MyTask.h"
 #include "MyLog.h"
 #include "CacheManager.h"
+#include "KeywordCache.h"
+#include "MultiBytesCharacter.h"
+#include "JsonWriter.h"
 #include "nlohmann/json.hpp"
 #include "fifo_map.hpp"
 using namespace nlohmann;
@@ -11,66 +14,357 @@ using my_json = basic_json<my_workaround_fifo_map>;
 using Json = my_json;
 
 #include <ErrorCheck>
+#include <algorithm>
 
 namespace wdcpp
 {
-extern __thread size_t __thread_id; // 工作线程的编号（0, 1, 2, ... , _workerNum-1）
+/**
+ *  将 json 请求转换为 WireRequest（缺省字段取服务端默认值）
+ *
+ *  1. 与二进制协议的 decodeRequest 一致：批量请求不允许嵌套，子请求个数不超过 WIRE_MAX_BATCH，
+ *     否则返回 false
+ */
+static bool fromJson(const Json &root, WireRequest &request, bool nested = false)
+{
+    request.msgID = root.value("msgID", 0);
+    request.cursor = root.value("cursor", (uint64_t)0);
+    request.offset = root.value("offset", (uint32_t)0);
+    request.limit = root.value("limit", WIRE_DEFAULT);
+    request.budget = root.value("budget", WIRE_DEFAULT);
+    if (4 == request.msgID)
+    {
+        const Json &subs = root.at("msg");
+        if (nested || !subs.is_array() || subs.size() > WIRE_MAX_BATCH)
+            return false;
+        request.subRequests.reserve(subs.size());
+        for (auto &sub : subs)
+        {
+            request.subRequests.emplace_back();
+            if (!fromJson(sub, request.subRequests.back(), true))
+                return false;
+        }
+    }
+    else
+        request.msg = root.value("msg", string());
+    return true;
+}
+
+/**
+ *  从 start 到现在经过的微秒数（作为缓存记录的计算开销）
+ */
+static uint32_t elapsedMicros(Deadline::Clock::time_point start)
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Deadline::now() - start).count();
+    return (uint32_t)std::min<int64_t>(elapsed, UINT32_MAX);
+}
+
+/**
+ *  二进制协议的错误响应：400 请求无法解析
+ */
+static string badRequest(const char *reason)
+{
+    string response;
+    BinaryWriter writer(response);
+    writer.putU16(400).putString(reason);
+    return response;
+}
 
 void MyTask::process() // 由子线程（TheadPool）调用！！！
 {
 
 #ifdef __DEBUG__
     printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
-    cout << _msg << endl;
+    cout << _msg.body << endl;
 #endif
 
+    if (_msg.format == WireFormat::Binary && _msg.header.version > WIRE_VERSION) // 客户端版本更高：告知服务端版本
+    {
+        string response;
+        BinaryWriter writer(response);
+        writer.putU16(505).putU8(WIRE_VERSION);
+        reply(response);
+        return;
+    }
+
+    WireRequest request;
+    if (!decode(request))
+    {
+        reply(_msg.format == WireFormat::Binary ? badRequest("bad request") : "");
+        return;
+    }
+
     string response;
+    if (1 == request.msgID)
+    {
+        if (!doKeyword(request.msg, response)) // 已交给 redis，结果返回后再回复
+            return;
+    }
+    else if (2 == request.msgID)
+    {
+        ParsedQuery query = _webPageSearcher.parseQuery(request.msg); // 只分词一次，并得到规范化的缓存键
+        response = doSearch(query, request.offset, limitOf(request), deadlineOf(request));
+    }
+    else if (3 == request.msgID) // 翻页
+    {
+        response = _webPageSearcher.doPage(request.cursor, request.msg, request.offset, limitOf(request),
+                                           _msg.format, deadlineOf(request));
+    }
+    else if (4 == request.msgID) // 批量请求，一帧请求对应一帧响应
+    {
+        response = doBatch(request);
+    }
+    else if (5 == request.msgID) // 前缀补全（查表即得，不经过缓存）
+    {
+        response = _recommander.doComplete(foldCharacters(request.msg), _msg.format);
+    }
+    else
+    {
+        ERROR_PRINT("Error: msgID = %d", request.msgID);
+        response = _msg.format == WireFormat::Binary ? badRequest("unknown msgID") : "";
+    }
+
+    // send
+    reply(response); // 注意，response 是已经序列化后的字符串
+}
+
+/**
+ *  解码请求：二进制报文体按协议解码，json 报文体解析后转换（坏请求返回 false）
+ */
+bool MyTask::decode(WireRequest &request)
+{
+    if (_msg.format == WireFormat::Binary)
+        return decodeRequest(_msg.header.type, _msg.body, request);
 
-    Json root = json::parse(_msg); // 解析 _msg
-    size_t msgID = root["msgID"];
-    if (1 == msgID)
+    try
     {
-        string word = root["msg"];
-        string key = word;
-        auto result = _redis.get(key); // 查询 redis
-        if (result)
+        Json root = json::parse(_msg.body); // 解析 _msg
+        if (!fromJson(root, request))
         {
-            response = result.value();
-            cout << "key hit redis: <" << word << ", ...>" << endl;
-        }
-        else
-        {
-            LogInfo("\n\tredis miss: %s", word.c_str());
-            response = _recommander.doQuery(word); // 查询词典（在 doQuery 中序列化）
-            _redis.setex(key, 60, response);
-            cout << "key insert redis: <" << word << ", ...>" << endl;
+            LogError("\n\tbad json request: nested or oversized batch");
+            return false;
         }
     }
-    else if (2 == msgID)
+    catch (const json::exception &e)
+    {
+        LogError("\n\tbad json request: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+/**
+ *  按请求所用的协议回复（二进制响应的 type 取自报文体开头的 msgID，requestID 原样带回）
+ */
+void MyTask::reply(const string &response)
+{
+    if (_msg.format == WireFormat::Json)
     {
-        string query = root["msg"];
+        _connPtr->notifyLoop(response);
+        return;
+    }
+
+    FrameHeader header;
+    header.version = std::min(_msg.header.version, WIRE_VERSION);
+    header.type = response.size() >= 2 ? loadU16(response.data()) : 0;
+    header.requestID = _msg.header.requestID;
+    _connPtr->notifyLoop(header, response);
+}
+
+/**
+ *  两种协议的结果不同，缓存键以 \x01 区分（规范化后的查询与关键词中不含控制字符）
+ */
+string MyTask::cacheKey(const string &key) const
+{
+    return _msg.format == WireFormat::Binary ? '\x01' + key : key;
+}
 
-        CacheManager *pManager = CacheManager::getInstance();
-        // 查 LRU 缓存，若命中直接发送
-        if ((response = pManager->getCacheGroup(__thread_id).getRecord(query)) == "")
+size_t MyTask::limitOf(const WireRequest &request) const
+{
+    return request.limit == WIRE_DEFAULT ? _pageSize : request.limit;
+}
+
+/**
+ *  时间预算从请求到达时算起
+ */
+Deadline MyTask::deadlineOf(const WireRequest &request) const
+{
+    return Deadline(_arrivalTime, request.budget == WIRE_DEFAULT ? _queryBudget : request.budget);
+}
+
+/**
+ *  批量请求：未命中缓存的网页查询一起交给 doBatch，所有子请求共用一个时间预算
+ */
+string MyTask::doBatch(const WireRequest &request)
+{
+    Deadline deadline = deadlineOf(request);
+    const vector<WireRequest> &subRequests = request.subRequests;
+
+    vector<string> responses(subRequests.size()); // 与子请求一一对应
+    vector<PageRequest> pageRequests;              // 未命中缓存的网页查询，一起交给 doBatch
+    vector<size_t> pageIndexes;                    // pageRequests 中每个查询在子请求中的下标
+    for (size_t idx = 0; idx < subRequests.size(); ++idx)
+    {
+        const WireRequest &sub = subRequests[idx];
+        if (1 == sub.msgID) // 不等待 redis：一级缓存未命中即查词典
+        {
+            string word = foldCharacters(sub.msg);
+            string key = cacheKey(word);
+            if (!KeywordCache::getInstance()->get(key, responses[idx]))
+                responses[idx] = doRecommend(word, key);
+        }
+        else if (2 == sub.msgID)
         {
-            // 若未命中
-            // 将 response 插入
-            LogInfo("\n\tLRU miss: %s", query.c_str());
-            response = _webPageSearcher.doQuery(query);
-            pManager->getCacheGroup(__thread_id).insertRecord(query, response);
-            cout << "query insert LRU: <" << query << ", ...>" << endl;
+            ParsedQuery query = _webPageSearcher.parseQuery(sub.msg);
+            size_t offset = sub.offset;
+            size_t limit = limitOf(sub);
+            bool cacheable = offset == 0 && limit == _pageSize;
+            LRUCache::Value record;
+            if (cacheable && (record = CacheManager::getInstance()->getRecord(cacheKey(query.key))) &&
+                _webPageSearcher.doCachedQuery(query, *record, _msg.format, responses[idx]))
+            {
+                cout << "query hit LRU: <" << query.text << ", ...>" << endl;
+                continue;
+            }
+            pageRequests.push_back({std::move(query), offset, limit, cacheable});
+            pageIndexes.push_back(idx);
         }
+        else if (3 == sub.msgID)
+            responses[idx] = _webPageSearcher.doPage(sub.cursor, sub.msg, sub.offset, limitOf(sub), _msg.format, deadline);
+        else if (5 == sub.msgID)
+            responses[idx] = _recommander.doComplete(foldCharacters(sub.msg), _msg.format);
         else
-            cout << "query hit LRU: <" << query << ", ...>" << endl;
+            ERROR_PRINT("Error: batch sub msgID = %d", sub.msgID);
     }
-    else
+
+    Deadline::Clock::time_point start = Deadline::now();
+    vector<string> pageResponses = _webPageSearcher.doBatch(pageRequests, _msg.format, deadline);
+    uint32_t cost = pageRequests.empty() ? 0 : elapsedMicros(start) / pageRequests.size(); // 一起检索，按平均开销计
+    for (size_t idx = 0; idx < pageRequests.size(); ++idx)
     {
-        ERROR_PRINT("Error: msgID = %d", msgID);
-        response = "";
+        PageRequest &pageRequest = pageRequests[idx];
+        if (!pageRequest.record.empty()) // 只缓存完整的默认首页
+            CacheManager::getInstance()->insertRecord(cacheKey(pageRequest.query.key), std::make_shared<const string>(std::move(pageRequest.record)), cost);
+        responses[pageIndexes[idx]] = std::move(pageResponses[idx]);
     }
 
-    // send
-    _connPtr->notifyLoop(response); // 注意，response 是已经序列化后的字符串
+    string response;
+    if (_msg.format == WireFormat::Binary) // 子响应原样写入，长度为 0 表示无结果
+    {
+        BinaryWriter writer(response);
+        writer.putU16(300).putU32(responses.size());
+        for (auto &subResponse : responses)
+            writer.putString(subResponse);
+        return response;
+    }
+
+    // 子响应都是完整的 json，原样写入，无需再次解析
+    JsonWriter writer(response);
+    writer.beginObject().key("msgID").value(300).key("msg").beginArray();
+    for (auto &subResponse : responses)
+    {
+        if (subResponse.empty())
+            writer.null();
+        else
+            writer.raw(subResponse);
+    }
+    writer.endArray().endObject();
+    return response;
+}
+
+/**
+ *  关键词推荐（先查进程内的一级缓存，再查 redis，都未命中再查词典）
+ *
+ *  1. 命中一级缓存时写入 response 并返回 true
+ *  2. 否则把本任务的副本作为回调交给 redis 线程并返回 false，由 onRedisReply 回复
+ *  3. redis 已停止（正在退出）时直接查词典
+ */
+bool MyTask::doKeyword(const string &msg, string &response)
+{
+    string word = foldCharacters(msg); // 全/半角、大小写、空白不同的关键词共用一条缓存
+    string key = cacheKey(word);
+    if (KeywordCache::getInstance()->get(key, response)) // 命中一级缓存，无需访问 redis
+        return true;
+
+    using namespace std::placeholders;
+    if (_redis.get(key, std::bind(&MyTask::onRedisReply, *this, word, key, _1))) // 查询 redis，不等待
+        return false;
+
+    response = doRecommend(word, key);
+    return true;
+}
+
+/**
+ *  redis 返回后的继续处理（在 redis 线程中调用）
+ *
+ *  1. 命中则放入一级缓存并回复
+ *  2. 未命中则交回线程池查词典，不占用 redis 线程
+ */
+void MyTask::onRedisReply(const string &word, const string &key, const sw::redis::OptionalString &result)
+{
+    KeywordCache *pKeywordCache = KeywordCache::getInstance();
+    pKeywordCache->recordRedis((bool)result);
+    if (result)
+    {
+        cout << "key hit redis: <" << word << ", ...>" << endl;
+        pKeywordCache->put(key, result.value());
+        reply(result.value());
+        return;
+    }
+
+    LogInfo("\n\tredis miss: %s", word.c_str());
+    _pool.addTask(std::bind(&MyTask::recommend, *this, word, key));
+}
+
+/**
+ *  查词典并回复（在线程池中调用）
+ */
+void MyTask::recommend(const string &word, const string &key)
+{
+    reply(doRecommend(word, key));
+}
+
+/**
+ *  查词典（在 doQuery 中序列化），结果写入 redis 与一级缓存
+ */
+string MyTask::doRecommend(const string &word, const string &key)
+{
+    KeywordCache *pKeywordCache = KeywordCache::getInstance();
+    string response = _recommander.doQuery(word, _msg.format);
+    _redis.setex(key, pKeywordCache->getTTL(), response);
+    cout << "key insert redis: <" << word << ", ...>" << endl;
+    pKeywordCache->put(key, response);
+    return response;
+}
+
+/**
+ *  网页查询（只有默认大小的首页经过 LRU 缓存，超时的不完整结果不缓存）
+ *
+ *  1. 缓存的是不含游标的记录，命中时由 doCachedQuery 重新登记排序结果并写入新游标
+ */
+string MyTask::doSearch(const ParsedQuery &query, size_t offset, size_t limit, const Deadline &deadline)
+{
+    if (offset != 0 || limit != _pageSize) // 只缓存默认大小的首页
+        return _webPageSearcher.doQuery(query, offset, limit, _msg.format, deadline);
+
+    string response;
+    CacheManager *pManager = CacheManager::getInstance();
+    LRUCache::Value record = pManager->getRecord(cacheKey(query.key)); // 查 LRU 缓存
+    if (record && _webPageSearcher.doCachedQuery(query, *record, _msg.format, response))
+    {
+        cout << "query hit LRU: <" << query.text << ", ...>" << endl;
+        return response;
+    }
+
+    // 若未命中，检索后将记录插入（超时的不完整结果没有记录）
+    LogInfo("\n\tLRU miss: %s", query.text.c_str());
+    string newRecord;
+    Deadline::Clock::time_point start = Deadline::now();
+    response = _webPageSearcher.doQuery(query, offset, limit, _msg.format, deadline, &newRecord);
+    if (!newRecord.empty())
+    {
+        pManager->insertRecord(cacheKey(query.key), std::make_shared<const string>(std::move(newRecord)), elapsedMicros(start)); // 记录重新计算的开销
+        cout << "query insert LRU: <" << query.text << ", ...>" << endl;
+    }
+    return response;
 }
 }; // namespace wdcpp
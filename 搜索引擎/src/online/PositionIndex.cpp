@@ -0,0 +1,168 @@
+#include "PositionIndex.h"
+#include "VarInt.h"
+#include "MyLog.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace wdcpp
+{
+/**
+ *  将 path 只读映射到内存，文件长度不足 minSize 时视为损坏
+ */
+static const char *mapFile(const string &path, size_t minSize, size_t &size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        LogError("can not open %s", path.c_str());
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || st.st_size == 0 || (size_t)st.st_size < minSize)
+    {
+        LogError("bad position index: %s", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        LogError("mmap %s failed", path.c_str());
+        return nullptr;
+    }
+    size = st.st_size;
+    return (const char *)addr;
+}
+
+PositionIndex::PositionIndex()
+    : _data(nullptr),
+      _size(0),
+      _table(nullptr),
+      _tableSize(0),
+      _header(nullptr),
+      _words(nullptr),
+      _entries(nullptr),
+      _names(nullptr)
+{
+}
+
+PositionIndex::~PositionIndex()
+{
+    if (_data)
+        ::munmap((void *)_data, _size);
+    if (_table)
+        ::munmap((void *)_table, _tableSize);
+}
+
+/**
+ *  映射 positions.dat（dataPath）与 positionsIndex.dat（indexPath），并校验文件头与长度
+ *
+ *  1. 在启动时调用，任一路径为空（未配置位置索引）时直接返回 false
+ */
+bool PositionIndex::load(const string &dataPath, const string &indexPath)
+{
+    if (dataPath.empty() || indexPath.empty())
+        return false;
+
+    size_t size = 0, tableSize = 0;
+    const char *data = mapFile(dataPath, 1, size);
+    if (!data)
+        return false;
+    const char *table = mapFile(indexPath, sizeof(PositionHeader), tableSize);
+    if (!table)
+    {
+        ::munmap((void *)data, size);
+        return false;
+    }
+
+    const PositionHeader *header = (const PositionHeader *)table;
+    size_t expected = sizeof(PositionHeader) + header->wordCount * sizeof(PositionWord) +
+                      header->entryCount * sizeof(PositionEntry) + header->nameBytes;
+    if (header->magic != POSITION_MAGIC || header->version != POSITION_VERSION || expected != tableSize)
+    {
+        LogError("bad position index: %s", indexPath.c_str());
+        ::munmap((void *)data, size);
+        ::munmap((void *)table, tableSize);
+        return false;
+    }
+
+    _data = data;
+    _size = size;
+    _table = table;
+    _tableSize = tableSize;
+    _header = header;
+    _words = (const PositionWord *)(_table + sizeof(PositionHeader));
+    _entries = (const PositionEntry *)(_words + _header->wordCount);
+    _names = (const char *)(_entries + _header->entryCount);
+    LogInfo("position index loaded: %lu words, %lu entries", (size_t)_header->wordCount, (size_t)_header->entryCount);
+    return true;
+}
+
+bool PositionIndex::isLoaded() const
+{
+    return _header != nullptr;
+}
+
+/**
+ *  查找 <word, docid> 的记录：先在单词表中、再在该词的记录中二分查找
+ *
+ *  1. 记录越界（数据损坏）时视为不存在
+ */
+const PositionEntry *PositionIndex::findEntry(string_view word, PageID docid) const
+{
+    if (!_header)
+        return nullptr;
+
+    auto nameOf = [this](const PositionWord &entry) {
+        if (entry.nameOffset > _header->nameBytes || entry.nameLength > _header->nameBytes - entry.nameOffset)
+            return string_view();
+        return string_view(_names + entry.nameOffset, entry.nameLength);
+    };
+    const PositionWord *wordsEnd = _words + _header->wordCount;
+    const PositionWord *wordIt = std::lower_bound(_words, wordsEnd, word, [&](const PositionWord &entry, string_view key) {
+        return nameOf(entry) < key;
+    });
+    if (wordIt == wordsEnd || nameOf(*wordIt) != word)
+        return nullptr;
+    if (wordIt->begin > _header->entryCount || wordIt->count > _header->entryCount - wordIt->begin)
+        return nullptr;
+
+    const PositionEntry *first = _entries + wordIt->begin;
+    const PositionEntry *last = first + wordIt->count;
+    const PositionEntry *entryIt = std::lower_bound(first, last, docid, [](const PositionEntry &entry, PageID key) {
+        return entry.docid < key;
+    });
+    if (entryIt == last || entryIt->docid != docid || entryIt->offset >= _size)
+        return nullptr;
+    return entryIt;
+}
+
+/**
+ *  获取 word 在网页 docid 中的所有位置（升序）
+ *
+ *  1. word 不在该网页中、位置索引未加载或数据损坏时返回 false
+ */
+bool PositionIndex::getPositions(const string &word, PageID docid, vector<uint32_t> &positions) const
+{
+    const PositionEntry *entry = findEntry(word, docid);
+    if (!entry)
+        return false;
+    return decodePositions(_data + entry->offset, _data + _size, positions);
+}
+
+/**
+ *  获取 word 在网页 docid 的原文 content 中第一次出现的字节偏移
+ *
+ *  1. 不存在时返回 NO_ANCHOR
+ */
+uint32_t PositionIndex::getAnchor(const string &word, PageID docid) const
+{
+    const PositionEntry *entry = findEntry(word, docid);
+    return entry ? entry->anchor : NO_ANCHOR;
+}
+}; // namespace wdcpp
@@ -0,0 +1,103 @@
+#include "QueryNormalizer.h"
+#include "SplitTool.h"
+#include "SegmentCache.h"
+#include "MultiBytesCharacter.h"
+
+#include <algorithm>
+#include <vector>
+#include <utility>
+using std::pair;
+using std::vector;
+
+namespace wdcpp
+{
+QueryNormalizer::QueryNormalizer(SplitTool &splitTool,
+                                 const unordered_set<string> &stopWords,
+                                 const unordered_map<string, TermID> &termIDs)
+    : _splitTool(splitTool),
+      _stopWords(stopWords),
+      _termIDs(termIDs)
+{
+}
+
+/**
+ *  规范化查询语句
+ *
+ *  1. key 的格式为 "id[xfreq],id[xfreq],...|word\tword\t..."
+ *     前半部分为按 TermID 排序的已知单词，后半部分为按字典序排序的未收录单词
+ *     （规范化后的单词中不含 \t，因此可用作分隔符）
+ *  2. 仅空白、全/半角、大小写、停用词或词序不同的查询得到相同的 key
+ *  3. 短语查询（"..."）的 key 以 '"' 开头并保留词序与偏移；去除停用词后不足两个词的短语按普通查询处理
+ */
+ParsedQuery QueryNormalizer::normalize(const string &query) const
+{
+    ParsedQuery parsed;
+    parsed.text = foldCharacters(query);
+
+    string body = parsed.text;
+    if (body.size() >= 2 && body.front() == '"' && body.back() == '"')
+    {
+        parsed.phrase = true;
+        body = body.substr(1, body.size() - 2);
+    }
+
+    SegmentListPtr segments = SegmentCache::getInstance()->cut(body, _splitTool); // 分词（重复的语句直接取缓存）
+    for (auto &word : *segments)
+    {
+        string folded = foldCharacters(word.word);
+        if (folded.empty() || _stopWords.count(folded)) // 去除空白与停用词
+            continue;
+        ++parsed.wordsMap[folded];
+        if (parsed.phrase)
+            parsed.phraseTerms.push_back({folded, word.offset});
+    }
+    if (parsed.phraseTerms.size() < 2)
+    {
+        parsed.phrase = false;
+        parsed.phraseTerms.clear();
+    }
+
+    if (parsed.phrase) // 短语与词序、词间距有关：key 为 "\"word@offset\tword@offset..."
+    {
+        parsed.key += '"';
+        for (size_t idx = 0; idx < parsed.phraseTerms.size(); ++idx)
+        {
+            if (idx > 0)
+                parsed.key += '\t';
+            parsed.key += parsed.phraseTerms[idx].first + '@' + std::to_string(parsed.phraseTerms[idx].second);
+        }
+        return parsed;
+    }
+
+    vector<pair<TermID, int>> terms; // <TermID, freq>
+    vector<string> unknownWords;     // 倒排索引中没有的单词
+    for (auto &wordPair : parsed.wordsMap)
+    {
+        auto it = _termIDs.find(wordPair.first);
+        if (it != _termIDs.end())
+            terms.push_back({it->second, wordPair.second});
+        else
+            unknownWords.push_back(wordPair.first);
+    }
+    std::sort(terms.begin(), terms.end());
+    std::sort(unknownWords.begin(), unknownWords.end());
+
+    for (auto &term : terms)
+    {
+        if (!parsed.key.empty())
+            parsed.key += ',';
+        parsed.key += std::to_string(term.first);
+        if (term.second > 1)
+            parsed.key += 'x' + std::to_string(term.second);
+    }
+    parsed.key += '|';
+    for (size_t idx = 0; idx < unknownWords.size(); ++idx)
+    {
+        if (idx > 0)
+            parsed.key += '\t';
+        parsed.key += unknownWords[idx];
+    }
+
+    return parsed;
+}
+}; // namespace wdcpp
@@ -0,0 +1,94 @@
+#include "SegmentCache.h"
+#include "MutexLockGuard.h"
+#include "SplitTool.h"
+#include "Configuration.h"
+
+#include <iostream>
+
+namespace wdcpp
+{
+SegmentCache *SegmentCache::_pInstance = SegmentCache::getInstance(); // 饿汉
+
+SegmentCache *SegmentCache::getInstance()
+{
+    if (_pInstance == nullptr)
+    {
+        _pInstance = new SegmentCache();
+        atexit(destroy);
+    }
+    return _pInstance;
+}
+
+SegmentCache::SegmentCache()
+    : _capacityPerShard(Configuration::getInstance()->getNumber("segmentcachenum", 10000) / SHARD_NUM + 1),
+      _hits(0),
+      _misses(0)
+{
+}
+
+void SegmentCache::destroy()
+{
+    using namespace std;
+    cout << "void SegmentCache::destroy()" << endl;
+    if (_pInstance)
+    {
+        delete _pInstance;
+        _pInstance = nullptr;
+    }
+}
+
+/**
+ *  获取语句 text 的分词结果
+ *
+ *  1. 命中则直接返回缓存的结果，未命中则用 tool 分词并存入缓存
+ *  2. 分词在锁外进行，同一语句并发未命中时可能重复分词，结果相同，后者覆盖前者
+ */
+SegmentListPtr SegmentCache::cut(const string &text, SplitTool &tool)
+{
+    Shard &shard = _shards[std::hash<string>()(text) % SHARD_NUM];
+    {
+        MutexLockGuard autolock(shard.mutex);
+        auto it = shard.hashMap.find(text);
+        if (it != shard.hashMap.end())
+        {
+            shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second); // 移至头部
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->second;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+
+    auto segments = std::make_shared<SegmentList>();
+    for (auto &word : tool.cutWithOffset(text))
+        segments->push_back({word.word, word.offset});
+
+    MutexLockGuard autolock(shard.mutex);
+    auto it = shard.hashMap.find(text);
+    if (it != shard.hashMap.end()) // 其他线程已存入
+    {
+        it->second->second = segments;
+        shard.entryList.splice(shard.entryList.begin(), shard.entryList, it->second);
+    }
+    else
+    {
+        shard.entryList.push_front({text, segments});
+        shard.hashMap[text] = shard.entryList.begin();
+        if (shard.entryList.size() > _capacityPerShard) // 已满，淘汰最久未访问的语句
+        {
+            shard.hashMap.erase(shard.entryList.back().first);
+            shard.entryList.pop_back();
+        }
+    }
+    return segments;
+}
+
+uint64_t SegmentCache::getHits() const
+{
+    return _hits.load(std::memory_order_relaxed);
+}
+
+uint64_t SegmentCache::getMisses() const
+{
+    return _misses.load(std::memory_order_relaxed);
+}
+}; // namespace wdcpp
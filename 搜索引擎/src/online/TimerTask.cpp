@@ -1,10 +1,28 @@
 #include "TimerTask.h"
 #include "CacheManager.h"
+#include "SegmentCache.h"
+#include "KeywordCache.h"
+#include "IntersectionCache.h"
+#include "MyLog.h"
 
 namespace wdcpp
 {
 void TimerTask::process()
 {
-    CacheManager::getInstance()->sync(); // 同步缓存
+    CacheManager *pManager = CacheManager::getInstance(); // 同步缓存，输出丢失与全量复制的次数
+    pManager->sync();
+    if (pManager->getMode() == CacheMode::Group)
+        LogInfo("\n\tcache sync: %lu records dropped, %lu full copies", pManager->getDroppedRecords(), pManager->getFullCopies());
+
+    SegmentCache *pSegmentCache = SegmentCache::getInstance(); // 输出分词缓存的命中情况
+    LogInfo("\n\tsegment cache: %lu hits, %lu misses", pSegmentCache->getHits(), pSegmentCache->getMisses());
+
+    IntersectionCache *pIntersectionCache = IntersectionCache::getInstance(); // 输出倒排列表交集缓存的命中情况
+    LogInfo("\n\tintersection cache: %lu hits, %lu misses", pIntersectionCache->getHits(), pIntersectionCache->getMisses());
+
+    KeywordCache *pKeywordCache = KeywordCache::getInstance(); // 输出关键词推荐两级缓存的命中情况
+    LogInfo("\n\tkeyword cache: L1 %lu hits, %lu misses; redis %lu hits, %lu misses",
+            pKeywordCache->getHits(), pKeywordCache->getMisses(),
+            pKeywordCache->getRedisHits(), pKeywordCache->getRedisMisses());
 }
 }; // namespace wdcpp
@@ -2,31 +2,77 @@
 #include "Configuration.h"
 #include "MyLog.h"
 #include "MultiBytesCharacter.h"
-#include "nlohmann/json.hpp"
-#include "fifo_map.hpp"
-using namespace nlohmann;
-/* 以下为 nlohmann/json 库使用，保证插入顺序不变 */
-template <class K, class V, class dummy_compare, class A>
-using my_workaround_fifo_map = fifo_map<K, V, fifo_map_compare<K>, A>;
-using my_json = basic_json<my_workaround_fifo_map>;
-using Json = my_json;
+#include "JsonWriter.h"
+#include "VarInt.h"
 
 #include <ErrorCheck>
-#include <set>
+#include <queue>
+#include <sstream>
+#include <algorithm>
 #include <math.h>
-using std::multiset;
+#include <sys/stat.h>
+using std::priority_queue;
 
 namespace wdcpp
 {
+/**
+ *  索引的版本号：各索引文件的路径、大小、修改时间与影响查询结果的配置项的 FNV-1a 哈希
+ */
+static uint64_t indexGeneration()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const string &str) {
+        for (unsigned char ch : str)
+        {
+            hash ^= ch;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff; // 分隔符，使 "ab" + "c" 与 "a" + "bc" 不同
+        hash *= 1099511628211ULL;
+    };
+
+    Configuration *pConf = Configuration::getInstance();
+    for (const char *key : {"ripepage", "offset", "invertIndex", "stopwords", "docStats", "positions", "positionsIndex"})
+    {
+        string path = pConf->get(key, "");
+        mix(path);
+        struct stat st;
+        if (!path.empty() && ::stat(path.c_str(), &st) == 0)
+        {
+            mix(std::to_string(st.st_size));
+            mix(std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec));
+        }
+    }
+    for (const char *key : {"scorer", "staticrankweight", "maxpagenum", "pagesize", "prettyjson"})
+        mix(pConf->get(key, ""));
+    return hash;
+}
+
 WebPageSearcher::WebPageSearcher()
+    : _scorerType(toScorerType(Configuration::getInstance()->get("scorer", "cosine"))),
+      _normalizer(_splitTool, _stopWords, _termIDs),
+      _staticRankWeight(stod(Configuration::getInstance()->get("staticrankweight", "0.2"))),
+      _maxPageNum(stoul(Configuration::getInstance()->getConfigMap()["maxpagenum"])),
+      _intersectionMin(Configuration::getInstance()->getNumber("intersectionmin", 1024)),
+      _prettyJson(Configuration::getInstance()->getNumber("prettyjson", 0) != 0),
+      _cursorCache(Configuration::getInstance()->getNumber("cursornum", 10000),
+                   Configuration::getInstance()->getNumber("cursorttl", 300)),
+      _generation(indexGeneration())
 {
     loadFromFile();
 }
 
+uint64_t WebPageSearcher::getGeneration() const
+{
+    return _generation;
+}
+
 /**
  *  从磁盘中读入三个库（网页库，倒排索引库，停用词库）
  *
  *  1. 偏移库无需存入内存，仅在读入网页库时借用该库信息而已
+ *  2. 网页库整体读入 _docStore，查询时只通过 DocView 访问，不拷贝网页文本
+ *  3. 读入倒排索引后，按所选打分算法为每个词预先计算 IDF
  */
 void WebPageSearcher::loadFromFile()
 {
@@ -40,35 +86,16 @@ void WebPageSearcher::loadFromFile()
     string word;
     while (getline(stopWordsLib, word))
     {
-        _stopWords.push_back(word);
+        _stopWords.insert(foldCharacters(word));
     }
 
-    // 读入网页库
-    ifstream offsetLib(Configuration::getInstance()->getConfigMap()["offset"]);//偏移库
-    if (!offsetLib)
-    {
-        ERROR_PRINT("can not open offset.dat");
-        exit(EXIT_FAILURE);
-    }
-    ifstream ripepageLib(Configuration::getInstance()->getConfigMap()["ripepage"]);
-    if (!ripepageLib)
-    {
-        ERROR_PRINT("can not open ripepage.dat");
-        exit(EXIT_FAILURE);
-    }
-    string offsetLine;
-    int docid;
-    size_t beg, offset;
-    char buf[65535] = {0};
-    while (getline(offsetLib, offsetLine))
-    {
-        stringstream ss(offsetLine);
-        ss >> docid >> beg >> offset;
-        ripepageLib.read(buf, offset);
-        string doc(buf);
-        WebPage tmp(doc);
-        _pageList.push_back(std::move(tmp));
-    }
+    // 映射位置索引（可选，只映射文件，不解析）
+    _positionIndex.load(Configuration::getInstance()->get("positions", ""),
+                        Configuration::getInstance()->get("positionsIndex", ""));
+
+    // 读入网页库（借助偏移库切分出每篇网页）
+    _docStore.load(Configuration::getInstance()->getConfigMap()["ripepage"],
+                   Configuration::getInstance()->getConfigMap()["offset"]);
 
     // 读入倒排索引库
     ifstream invertIndexLib(Configuration::getInstance()->getConfigMap()["invertIndex"]);
@@ -77,147 +104,340 @@ void WebPageSearcher::loadFromFile()
         ERROR_PRINT("can not open invertIndex.dat");
         exit(EXIT_FAILURE);
     }
+    // 每行为 "word docid w' freq docid w' freq ..."
     string invertIndexLine;
     string keyWord;
-    double weight;
+    PageID docid;
+    Posting posting;
     while (getline(invertIndexLib, invertIndexLine))
     {
         stringstream ss(invertIndexLine);
 
         // ss >> keyWord >> docid >> weight;
         // _invertIndexTable[keyWord][docid] = weight;//一个单词在多篇文章，不行
-        ss >> keyWord;
-        while (ss)
+        if (!(ss >> keyWord))
+            continue;
+        _termIDs.insert({keyWord, (TermID)_termIDs.size()});
+        auto &pageIdMap = _invertIndexTable[keyWord];
+        while (ss >> docid >> posting.weight >> posting.freq) // 读取失败时停止，避免插入多余的 <0, 0>
         {
-            ss >> docid >> weight;
-            _invertIndexTable[keyWord][docid] = weight;
+            pageIdMap[docid] = posting;
         }
     }
 
     stopWordsLib.close();
-    offsetLib.close();
-    ripepageLib.close();
     invertIndexLib.close();
+
+    _corpusStats.docNum = _docStore.size();
+    if (_scorerType == ScorerType::BM25)
+        loadDocStats();
+
+    // 生成按 docid 升序排列的倒排列表（docid 越小静态排名越高）
+    for (auto &invertIndexPair : _invertIndexTable)
+    {
+        auto &postingList = _postingLists[invertIndexPair.first];
+        postingList.reserve(invertIndexPair.second.size());
+        for (auto &pagePair : invertIndexPair.second)
+            postingList.push_back(pagePair.first);
+        std::sort(postingList.begin(), postingList.end());
+    }
+
+    // 预先计算每个词的 IDF
+    _idf.resize(_termIDs.size(), 0.0);
+    for (auto &termPair : _termIDs) // pair<string, TermID> termPair
+    {
+        size_t DF = _invertIndexTable[termPair.first].size();
+        _idf[termPair.second] = _scorerType == ScorerType::BM25 ? BM25Scorer::idf(_corpusStats, DF)
+                                                                 : CosineScorer::idf(_corpusStats, DF);
+    }
 }
 
 /**
- *  查询网页信息
+ *  读入文章统计信息（仅 BM25 使用）
  *
- *  1. msg 已经序列化后的，由客户发送的查询语句（如：王道在线科技）
- *  2. 返回所有网页信息，并且已经序列化为 json 格式
+ *  1. 第一行为 "文章总数 平均文章长度"，其后每行为 "docid length"
+ *  2. 据此得到每篇文章的长度；每个 <word, docid> 的词频在倒排索引中
  */
-string WebPageSearcher::doQuery(string msg)
+void WebPageSearcher::loadDocStats()
 {
-    using namespace std;
-    cout << "doQuery: " << msg << endl;
-
-    WebPage pageX;
-    pageX.setPageContent(msg);               // 将 msg 作为 content 创建网页 pageX
-    pageX.splitWord(_splitTool, _stopWords); // 对 pageX 分词并统计词频
-
-    unordered_map<string, double> vecX = getVectorX(pageX); // 获取向量 vecX
-
-    string response;
-    set<PageID> IDs = getIDs(pageX); // 获取候选文章的编号集合 IDs（取交集）
-    // set<PageID> IDs = getIDs(pageX, vecX); // 记得剔除 vecX 和 pageX._wordsMap 中没有在交集集合 IDs 中出现过的单词
-
-    if (IDs.empty())
+    ifstream docStatsLib(Configuration::getInstance()->get("docStats", ""));
+    if (!docStatsLib)
     {
-        LogInfo("webPageSearcher miss: %s", msg.c_str());
-        response = serializeForNoting(); // 获取未找到网页的序列化信息
+        ERROR_PRINT("can not open docStats.dat (required by scorer bm25)");
+        exit(EXIT_FAILURE);
     }
-    else
+    string docStatsLine;
+    size_t docNum = 0;
+    getline(docStatsLib, docStatsLine);
+    istringstream header(docStatsLine);
+    header >> docNum >> _corpusStats.avgDocLength;
+
+    _corpusStats.docLengths.resize(_docStore.size(), 0);
+    PageID docid;
+    uint32_t length;
+    while (getline(docStatsLib, docStatsLine))
     {
-        vector<PageID> sortedIDs = getSortedIDs(vecX, IDs); // 获取排序后的候选文章的编号集合 sortedIDs
+        istringstream iss(docStatsLine);
+        if (!(iss >> docid >> length) || docid < 0)
+            continue;
+        if ((size_t)docid >= _corpusStats.docLengths.size())
+            _corpusStats.docLengths.resize(docid + 1, 0);
+        _corpusStats.docLengths[docid] = length;
+    }
+    docStatsLib.close();
 
-        setSummarys(sortedIDs, pageX); // 为所有候选文章设置摘要信息
+    if (docNum != _docStore.size())
+        LogWarn("docStats.dat has %lu docs, ripepage.dat has %lu", docNum, _docStore.size());
+}
 
-        response = serialize(sortedIDs); // 获取经过序列化后的所有网页信息
-    }
+/**
+ *  规范化查询语句（字符规范化、分词、去停用词），并生成缓存键
+ */
+ParsedQuery WebPageSearcher::parseQuery(const string &query) const
+{
+    return _normalizer.normalize(query);
+}
 
-    return response;
+/**
+ *  结果缓存记录（BinaryWriter 编码）：
+ *    string head  string tail  u32 count  count 个 u32 docid（按总分降序）
+ *
+ *  1. head + 游标 + tail 即为响应，cursorRange 为响应中游标字段的值的范围，
+ *     记录中不含游标本身
+ *  2. 没有找到文章时 count 为 0，head 即为整个响应，不需要游标
+ */
+static string makeRecord(const string &response, pair<size_t, size_t> cursorRange, const vector<PageID> &IDs)
+{
+    string_view view(response);
+    string record;
+    BinaryWriter writer(record);
+    writer.putString(view.substr(0, cursorRange.first)).putString(view.substr(cursorRange.second));
+    writer.putU32(IDs.size());
+    for (auto id : IDs)
+        writer.putU32((uint32_t)id);
+    return record;
 }
 
 /**
- *  求网页 pageX 的向量 vexX
+ *  首次查询网页信息
+ *
+ *  1. query 为已规范化的查询语句（如：王道在线科技）
+ *  2. 对候选文章排序，并将排序结果存入游标缓存
+ *  3. 只返回第 [offset, offset + limit) 篇网页信息，并且已经按 format 序列化
+ *  4. 超过 deadline 时返回已找到的最好结果（不完整，不生成缓存记录）
+ *  5. record 不为 nullptr 且结果完整时，输出可存入结果缓存的记录（见 makeRecord）
  */
-unordered_map<string, double> WebPageSearcher::getVectorX(WebPage &pageX)
+string WebPageSearcher::doQuery(const ParsedQuery &query, size_t offset, size_t limit, WireFormat format,
+                                const Deadline &deadline, string *record)
 {
-    unordered_map<string, double> vecX;                          // 向量 X
-    unordered_map<string, int> &wordsMapX = pageX.getWordsMap(); // <word, freq>
+    using namespace std;
+    cout << "doQuery: " << query.text << endl;
+
+    PostingsCache postingsCache;
+    CursorCache::RankedListPtr rankedList = rank(query, deadline, postingsCache);
+    if (rankedList->partial)
+        LogWarn("query exceeded its budget, partial results: %s", query.text.c_str());
+    if (rankedList->IDs.empty())
+    {
+        LogInfo("webPageSearcher miss: %s", query.text.c_str());
+        string response = serializeForNoting(rankedList->partial, format); // 获取未找到网页的序列化信息
+        if (record && !rankedList->partial)
+            *record = makeRecord(response, {response.size(), response.size()}, rankedList->IDs);
+        return response;
+    }
 
-    double sumWeight = 0.0; // pageX 中所有单词的权值平方和
+    CursorCache::Cursor cursor = _cursorCache.put(rankedList);
+    pair<size_t, size_t> cursorRange;
+    string response = serialize(cursor, *rankedList, offset, limit, format, &cursorRange);
+    if (record && !rankedList->partial)
+        *record = makeRecord(response, cursorRange, rankedList->IDs);
+    return response;
+}
 
-    for (auto &wordPair : wordsMapX) // pair<string, int> wordPair
+/**
+ *  由结果缓存记录生成响应（命中结果缓存时调用）
+ *
+ *  1. 重新登记记录中的排序结果，换上新的游标，翻页时仍只需生成摘要
+ *  2. 记录无法解析时返回 false（调用者按未命中处理）
+ */
+bool WebPageSearcher::doCachedQuery(const ParsedQuery &query, const string &record, WireFormat format, string &response)
+{
+    BinaryReader reader(record);
+    string_view head, tail;
+    uint32_t count = 0;
+    if (!reader.getString(head) || !reader.getString(tail) || !reader.getU32(count) || count > record.size() / 4)
+        return false;
+
+    auto rankedList = std::make_shared<RankedList>();
+    rankedList->wordsMap = query.wordsMap;
+    rankedList->IDs.resize(count);
+    for (auto &id : rankedList->IDs)
     {
-        double TF = (double)wordPair.second / wordsMapX.size();
-        int DF = _invertIndexTable[wordPair.first].size() + 1;
-        int N = _pageList.size() + 1;
-        double IDF = 0.0;
-        if (N != DF)
-            IDF = log10((double)N / (DF + 1));
-        double w = TF * IDF;
-        sumWeight += w * w; // 更新 sumWeight
-
-        vecX.insert({wordPair.first, w}); // <word, w>
+        uint32_t value = 0;
+        if (!reader.getU32(value) || value >= _docStore.size())
+            return false;
+        id = value;
     }
+    if (!reader.atEnd())
+        return false;
 
-    // if (sumWeight == 0.0)
-    // {
-    //     ERROR_PRINT("pageX's sumWeight equal 0.0\n");
-    //     exit(EXIT_FAILURE);
-    // }
+    response.assign(head.data(), head.size());
+    if (count > 0)
+    {
+        CursorCache::Cursor cursor = _cursorCache.put(rankedList);
+        if (format == WireFormat::Binary)
+            BinaryWriter(response).putU64(cursor);
+        else
+            response += std::to_string(cursor);
+    }
+    response.append(tail.data(), tail.size());
+    return true;
+}
 
-    for (auto &wordPair : vecX) // pair<string, double> wordPair
+/**
+ *  翻页查询网页信息
+ *
+ *  1. 凭游标取回排序结果，只需为当前页生成摘要并序列化
+ *  2. 若游标已过期，则规范化 query 后重新查询（返回新的游标）
+ */
+string WebPageSearcher::doPage(CursorCache::Cursor cursor, const string &query, size_t offset, size_t limit,
+                               WireFormat format, const Deadline &deadline)
+{
+    CursorCache::RankedListPtr rankedList = _cursorCache.get(cursor);
+    if (!rankedList)
     {
-        if (sumWeight == 0)
-            wordPair.second = 0;
-        wordPair.second /= sqrt(sumWeight); // <word, w'>
+        LogInfo("\n\tcursor expired: %s", query.c_str());
+        return doQuery(parseQuery(query), offset, limit, format, deadline);
     }
 
-    return vecX;
+    return serialize(cursor, *rankedList, offset, limit, format);
 }
 
 /**
- *  获取候选文章的编号集合 找到多个词出现的共同的文章id
+ *  批量查询网页信息，返回与 requests 一一对应的序列化结果
+ *
+ *  1. 规范化键相同的查询只检索一次，共用同一个游标
+ *  2. 所有查询共用一张 <word, 倒排列表> 查找表，重复出现的词只查一次倒排索引
+ *  3. 所有查询共用同一个 deadline
+ *  4. wantRecord 为 true 且结果完整时，在 record 中输出结果缓存记录
  */
-set<PageID> WebPageSearcher::getIDs(WebPage &pageX)
+vector<string> WebPageSearcher::doBatch(vector<PageRequest> &requests, WireFormat format, const Deadline &deadline)
 {
-    unordered_map<string, int> &wordsMapX = pageX.getWordsMap(); // <word, freq>
+    PostingsCache postingsCache;
+    unordered_map<string, pair<CursorCache::RankedListPtr, CursorCache::Cursor>> rankedLists; // <key, <排序结果, 游标>>
 
-    vector<set<PageID>> IDsArr;      // 存放所有单词所在网页 ID 的集合
-    for (auto &wordPair : wordskjMapX) // pair<string, int> wordPair
+    vector<string> responses;
+    for (auto &request : requests)
     {
-        set<PageID> IDs;                                                 // 存放 wordPair.first 所在网页 ID 的集合
-        for (auto &invertInvertPair : _invertIndexTable[wordPair.first]) // pair<PageID, double> invertInvertPair
+        auto it = rankedLists.find(request.query.key);
+        if (it == rankedLists.end())
         {
-            IDs.insert(invertInvertPair.first);
+            std::cout << "doBatch: " << request.query.text << std::endl;
+            CursorCache::RankedListPtr rankedList = rank(request.query, deadline, postingsCache);
+            CursorCache::Cursor cursor = 0;
+            if (!rankedList->IDs.empty())
+                cursor = _cursorCache.put(rankedList);
+            else
+                LogInfo("webPageSearcher miss: %s", request.query.text.c_str());
+            it = rankedLists.insert({request.query.key, {rankedList, cursor}}).first;
         }
-        IDsArr.push_back(std::move(IDs));
+
+        const RankedList &rankedList = *it->second.first;
+        pair<size_t, size_t> cursorRange;
+        if (rankedList.IDs.empty())
+        {
+            responses.push_back(serializeForNoting(rankedList.partial, format));
+            cursorRange = {responses.back().size(), responses.back().size()};
+        }
+        else
+            responses.push_back(serialize(it->second.second, rankedList, request.offset, request.limit, format, &cursorRange));
+        if (request.wantRecord && !rankedList.partial)
+            request.record = makeRecord(responses.back(), cursorRange, rankedList.IDs);
     }
+    return responses;
+}
+
+/**
+ *  获取排序后的候选文章编号（最多保留 _maxPageNum 篇）
+ *
+ *  1. 只有短语查询与多词查询才会触发位置索引的加载
+ *  2. 位置索引不可用时，短语查询退化为普通查询
+ */
+CursorCache::RankedListPtr WebPageSearcher::rank(const ParsedQuery &query, const Deadline &deadline, PostingsCache &postingsCache)
+{
+    auto rankedList = std::make_shared<RankedList>();
+    rankedList->wordsMap = query.wordsMap;
 
-    set<PageID> IDs;
-    for (auto &item : IDsArr) // set<PageID> item
+    if (query.wordsMap.empty())
+        return rankedList;
+    for (auto &wordPair : query.wordsMap)
     {
-        if (IDs.empty())
-            IDs = item;
-        else
+        if (!lookupTerm(wordPair.first, postingsCache)) // 有单词不在任何网页中出现，交集一定为空
+            return rankedList;
+    }
+
+    bool usePositions = (query.phrase || query.wordsMap.size() > 1) && _positionIndex.isLoaded();
+    if (query.phrase && !usePositions)
+        LogInfo("position index unavailable, phrase treated as words: %s", query.text.c_str());
+    bool phrase = query.phrase && usePositions; // 只保留精确包含该短语的文章
+
+    switch (_scorerType) // 每次查询只分派一次，打分循环中没有虚函数调用
+    {
+    case ScorerType::BM25:
+        rankedList->IDs = getSortedIDs<BM25Scorer>(query, phrase, usePositions, deadline, postingsCache, rankedList->partial);
+        break;
+    default:
+        rankedList->IDs = getSortedIDs<CosineScorer>(query, phrase, usePositions, deadline, postingsCache, rankedList->partial);
+        break;
+    }
+
+    return rankedList;
+}
+
+/**
+ *  在查找表中查找单词 word 的索引数据，表中没有时查一次各个索引并记入表中
+ *
+ *  1. word 不在倒排索引中时返回 nullptr（同样记入表中）
+ */
+const WebPageSearcher::TermPostings *WebPageSearcher::lookupTerm(const string &word, PostingsCache &postingsCache)
+{
+    auto cacheIt = postingsCache.find(word);
+    if (cacheIt == postingsCache.end())
+    {
+        TermPostings termPostings;
+        auto termIt = _termIDs.find(word);
+        auto indexIt = _invertIndexTable.find(word);
+        auto postingIt = _postingLists.find(word);
+        if (termIt != _termIDs.end() && indexIt != _invertIndexTable.end() && postingIt != _postingLists.end())
         {
-            set<PageID> tmp;
-            set_intersection(item.begin(), item.end(), IDs.begin(), IDs.end(), inserter(tmp, tmp.begin())); // 这里第五个参数不能就设置为 IDs
-            swap(IDs, tmp);
+            termPostings.entries = &indexIt->second;
+            termPostings.postings = &postingIt->second;
+            termPostings.idf = _idf[termIt->second];
+            termPostings.id = termIt->second;
         }
+        cacheIt = postingsCache.insert({word, termPostings}).first;
     }
-
-    return IDs;
+    return cacheIt->second.entries ? &cacheIt->second : nullptr;
 }
 
 /**
- *  根据余弦相似度算法，对候选文章的 ID 集合进行排序
+ *  求候选文章（包含所有查询词的文章）中总分最高的 _maxPageNum 篇，按总分降序排列
  *
- *  1. vecX 为向量 X
- *  2. IDs 为候选文章的 ID 集合
+ *  1. Scorer 为打分核心（CosineScorer / BM25Scorer），score 在热循环中被内联
+ *  2. 总分 = 查询得分（proximity 为 true 时乘以邻近度系数）+ 静态排名得分
+ *  3. 以最短的倒排列表驱动，按 docid 升序（静态排名降序）遍历，其余查询词只做查找；
+ *     已有 _maxPageNum 篇且剩余文章的总分上界不超过当前第 _maxPageNum 名时提前结束，
+ *     热门查询只需检查倒排列表的一个前缀
+ *  4. phrase 为 true 时，只保留精确包含该短语的文章
+ *  5. 短语匹配与邻近度都要解码位置列表，只对按最大邻近度系数计算仍可能进入前 k 名的文章进行
+ *  6. 每检查 CHECK_INTERVAL 篇文章检查一次 deadline，超时则返回当前的前 k 名，partial 置为 true
+ *  7. 多词查询且最短的倒排列表不短于 _intersectionMin 时，改以两个最稀有词的交集驱动，
+ *     交集由 IntersectionCursor 惰性求出（先用交集缓存中的前缀），仍按 docid 升序，
+ *     提前结束时只求了已扫描的部分；这两个词也无需再逐篇查找
  */
+const double PROXIMITY_WEIGHT = 0.5; // 邻近度系数的最大增量
+const size_t CHECK_INTERVAL = 64;    // 检查截止时间的间隔（文章数）
+
 struct MyGreater
 {
     bool operator()(const pair<double, PageID> &lhs, const pair<double, PageID> &rhs) const
@@ -228,133 +448,355 @@ struct MyGreater
             return lhs.second < rhs.second;
     }
 };
-vector<PageID> WebPageSearcher::getSortedIDs(const unordered_map<string, double> &vecX, const set<PageID> &IDs)
+template <typename Scorer>
+vector<PageID> WebPageSearcher::getSortedIDs(const ParsedQuery &query, bool phrase, bool proximity,
+                                             const Deadline &deadline, PostingsCache &postingsCache, bool &partial)
 {
-    multiset<pair<double, PageID>, MyGreater> sortCos;
+    vector<ScoringTerm> terms;                   // 查询词（只查一次倒排索引与 IDF）
+    vector<const TermPostings *> termPostingsList; // 与 terms 一一对应
+    size_t rarest = 0, second = SIZE_MAX;          // 倒排列表最短、次短的查询词下标
+    for (auto &wordPair : query.wordsMap)          // pair<string, int> wordPair
+    {
+        const TermPostings *termPostings = lookupTerm(wordPair.first, postingsCache);
+        if (!termPostings)
+            return {};
+        size_t length = termPostings->postings->size();
+        if (!termPostingsList.empty() && length < termPostingsList[rarest]->postings->size())
+        {
+            second = rarest;
+            rarest = termPostingsList.size();
+        }
+        else if (!termPostingsList.empty() && (second == SIZE_MAX || length < termPostingsList[second]->postings->size()))
+            second = termPostingsList.size();
+
+        terms.push_back({termPostings->entries, wordPair.second, termPostings->idf, 0.0});
+        termPostingsList.push_back(termPostings);
+    }
+
+    const vector<PageID> *driver = termPostingsList[rarest]->postings; // 驱动遍历的 docid 列表
+    unique_ptr<IntersectionCursor> intersection;                       // 以两个最稀有词的交集驱动时使用
+    if (second != SIZE_MAX && _intersectionMin > 0 && driver->size() >= _intersectionMin)
+    {
+        intersection.reset(new IntersectionCursor(
+            termPostingsList[rarest]->id, *termPostingsList[rarest]->postings,
+            termPostingsList[second]->id, *termPostingsList[second]->postings, _generation));
+    }
+    vector<const unordered_map<PageID, Posting> *> filters; // 驱动列表不能保证包含、需逐篇查找的词
+    for (size_t idx = 0; idx < terms.size(); ++idx)
+    {
+        if (idx != rarest && !(intersection && idx == second))
+            filters.push_back(terms[idx].entries);
+    }
+
+    Scorer scorer(_corpusStats);
+    scorer.prepare(terms); // 计算查询侧权重
+    double staticScale = _staticRankWeight * scorer.maxScore(terms);                      // 静态排名为 1 时的得分
+    double maxQueryScore = scorer.maxScore(terms) * (proximity ? 1.0 + PROXIMITY_WEIGHT : 1.0); // 查询得分上界
 
-    for (auto &id : IDs)
+    priority_queue<pair<double, PageID>, vector<pair<double, PageID>>, MyGreater> topK; // 堆顶为当前第 k 名
+    size_t examined = 0; // 已检查的文章数
+    PageID id = 0;
+    for (size_t pos = 0; intersection ? intersection->next(id) : pos < driver->size(); ++pos)
     {
-        unordered_map<string, double> vecY; // 向量 Yid
-        for (auto it = vecX.begin(); it != vecX.end(); ++it)
+        if (!intersection)
+            id = (*driver)[pos];
+        double staticScore = staticScale * _docStore.getStaticRank(id);
+        if (topK.size() >= _maxPageNum && (topK.empty() || maxQueryScore + staticScore <= topK.top().first))
+            break; // 其后的文章静态排名更低，不可能再进入前 k 名
+        if (++examined % CHECK_INTERVAL == 0 && deadline.expired())
         {
-            double w = _invertIndexTable[it->first][id];
-            vecY.insert(std::make_pair(it->first, w));
+            partial = true; // 超时，返回目前为止最好的结果
+            break;
         }
 
-        double innerProduct = 0, lengthXAbs = 0, lengthYAbs = 0;
-        for (auto it = vecX.begin(); it != vecX.end(); ++it)
+        bool containsAll = true;
+        for (auto entries : filters)
         {
-            innerProduct += it->second * vecY[it->first];
-            lengthXAbs += it->second * it->second;
-            lengthYAbs += vecY[it->first] * vecY[it->first];
+            if (entries->find(id) == entries->end())
+            {
+                containsAll = false;
+                break;
+            }
         }
+        if (!containsAll)
+            continue;
+
+        double score = scorer.score(terms, id);
+        double maxBoost = proximity ? 1.0 + PROXIMITY_WEIGHT : 1.0;
+        if (topK.size() >= _maxPageNum && (topK.empty() || score * maxBoost + staticScore < topK.top().first))
+            continue; // 邻近度系数取最大值也进不了前 k 名，不必解码位置
+        if (phrase && !matchPhrase(query.phraseTerms, id))
+            continue;
+        if (proximity)
+            score *= getProximityBoost(query.wordsMap, id);
+        pair<double, PageID> item(score + staticScore, id);
 
-        double Cos = innerProduct / ((sqrt(lengthXAbs) * sqrt(lengthYAbs)));
-        sortCos.insert(std::make_pair(Cos, id));
+        if (topK.size() < _maxPageNum)
+            topK.push(item);
+        else if (MyGreater()(item, topK.top()))
+        {
+            topK.pop();
+            topK.push(item);
+        }
     }
 
-    vector<PageID> result;
-    for (auto &id : sortCos)
+    vector<PageID> result(topK.size());
+    for (size_t idx = result.size(); idx > 0; --idx)
     {
-        result.push_back(id.second);
+        result[idx - 1] = topK.top().second;
+        topK.pop();
     }
     return result;
 }
 
 /**
- *  设置所有候选网页的摘要信息
+ *  短语匹配：words 是否按给定相对偏移连续出现在文章 id 中
+ *
+ *  1. words 为 <word, 相对短语开头的字节偏移>，偏移来自对规范化后的查询语句的分词，
+ *     与位置索引中的位置（规范化后文本中的偏移）可直接比较
+ *  2. 以第一个词的每个位置为起点，用二分查找验证其余词是否出现在对应位置
+ *  3. 整个短语须落在同一部分（title 或 content）中，不跨越二者的边界
  */
-void WebPageSearcher::setSummarys(vector<PageID> &sortedIDs, WebPage &pageX)
+bool WebPageSearcher::matchPhrase(const vector<pair<string, uint32_t>> &words, PageID id)
 {
-    const size_t STEP = 40;                                      // 目标字符待往左/右偏移的字符数
-    unordered_map<string, int> &wordsMapX = pageX.getWordsMap(); // <word, freq>
-    vector<PageID> tmpIDs = sortedIDs;
+    vector<vector<uint32_t>> positions(words.size()); // 每个词在当前文章中的位置
+    for (size_t idx = 0; idx < words.size(); ++idx)
+    {
+        if (!_positionIndex.getPositions(words[idx].first, id, positions[idx]))
+            return false;
+    }
 
-    for (auto &ID : tmpIDs) // 依次设置所有网页的摘要
+    for (auto pos : positions[0])
     {
-        static int n = 0;
-        cout << ++n << endl;
-        if (n == 1548)
+        bool inContent = pos >= CONTENT_POSITION_BASE;
+        if (pos - (inContent ? CONTENT_POSITION_BASE : 0) < words[0].second)
+            continue;
+        uint32_t start = pos - words[0].second; // 短语在文中的起始字节
+        bool match = true;
+        for (size_t idx = 1; idx < words.size() && match; ++idx)
         {
-            cout << "got it!" << endl;
+            uint32_t target = start + words[idx].second;
+            match = (target >= CONTENT_POSITION_BASE) == inContent &&
+                    std::binary_search(positions[idx].begin(), positions[idx].end(), target);
         }
+        if (match)
+            return true;
+    }
+    return false;
+}
 
-        const string content = _pageList[ID].getContent();
+/**
+ *  求文章 id 的邻近度加权系数，范围为 [1, 1 + PROXIMITY_WEIGHT]
+ *
+ *  1. 求覆盖所有查询词的最小窗口（字节数），窗口越接近查询词总长，系数越大
+ *  2. 滑动窗口：所有位置按升序归并后，维护一个包含全部查询词的最短区间
+ */
+double WebPageSearcher::getProximityBoost(const unordered_map<string, int> &wordsMapX, PageID id)
+{
+    vector<pair<uint32_t, size_t>> hits; // <位置, 查询词下标>
+    vector<size_t> wordLength;            // 每个查询词的字节数
+    vector<uint32_t> positions;
+    for (auto &wordPair : wordsMapX)
+    {
+        if (!_positionIndex.getPositions(wordPair.first, id, positions))
+            return 1.0;
+        for (auto pos : positions)
+            hits.push_back({pos, wordLength.size()});
+        wordLength.push_back(wordPair.first.size());
+    }
+    std::sort(hits.begin(), hits.end());
+
+    size_t idealLength = 0; // 所有查询词紧挨出现时的窗口长度
+    for (auto len : wordLength)
+        idealLength += len;
+
+    size_t minWindow = SIZE_MAX;
+    vector<size_t> count(wordLength.size(), 0); // 窗口内每个查询词出现的次数
+    size_t covered = 0;                        // 窗口内出现的不同查询词个数
+    for (size_t left = 0, right = 0; right < hits.size(); ++right)
+    {
+        if (count[hits[right].second]++ == 0)
+            ++covered;
+        while (covered == wordLength.size())
+        {
+            size_t window = hits[right].first + wordLength[hits[right].second] - hits[left].first;
+            minWindow = std::min(minWindow, window);
+            if (--count[hits[left].second] == 0)
+                --covered;
+            ++left;
+        }
+    }
+    if (minWindow == SIZE_MAX || minWindow == 0)
+        return 1.0;
+
+    return 1.0 + PROXIMITY_WEIGHT * std::min(1.0, (double)idealLength / minWindow);
+}
+
+/**
+ *  求文章 id 的 content 中首个查询词的字节偏移（摘要锚点），未知时返回 UINT32_MAX
+ *
+ *  1. 只为正在序列化的这一页文章计算
+ *  2. 位置索引为每个 <word, docid> 记录了原文中第一次出现的字节偏移，取各查询词中的最小者
+ *  3. 查询词只出现在 title 中或位置索引未加载时返回 UINT32_MAX
+ */
+uint32_t WebPageSearcher::getAnchor(PageID id, const unordered_map<string, int> &wordsMapX)
+{
+    uint32_t anchor = UINT32_MAX;
+    for (auto &wordPair : wordsMapX)
+        anchor = std::min(anchor, _positionIndex.getAnchor(wordPair.first, id));
+    return anchor;
+}
+
+/**
+ *  求网页 ID 的摘要在 content 中的范围 [left, right)
+ *
+ *  1. 以 content 中第一次出现查询词的位置为中心，左右各取 STEP 个字符
+ *  2. anchor 为位置索引记录的该位置，有效时无需在 content 中查找
+ *  3. 若查询词只出现在 title 中，则取 content 开头的 STEP 个字符
+ *  4. 只返回范围，由 serialize 直接写入输出缓冲区，不拷贝网页文本
+ */
+pair<size_t, size_t> WebPageSearcher::getSummaryRange(const DocView &page, const unordered_map<string, int> &wordsMapX, uint32_t anchor)
+{
+    const size_t STEP = 40; // 目标字符待往左/右偏移的字符数
+    string_view content = page.content;
 
-        size_t first_pos = SIZE_MAX;     // page 中第一次出现 wordsMapX 中的单词的位置
+    size_t first_pos = SIZE_MAX; // page 中第一次出现 wordsMapX 中的单词的位置
+    if (anchor < content.size())
+        first_pos = anchor;
+    else
+    {
         for (auto &wordPair : wordsMapX) // pair<string, int> wordPair
         {
-            string word = wordPair.first;
-            size_t pos = content.find(word);
-            // if (pos != string::npos && pos < first_pos)
+            size_t pos = content.find(wordPair.first);
             if (pos != content.npos && pos < first_pos)
                 first_pos = pos;
         }
+    }
+    if (first_pos == SIZE_MAX) // 这篇文章中的 content 部分没有 wordsMapX 中的单词（只在 title 部分有）
+        first_pos = 0;
 
-        if (first_pos == SIZE_MAX) // 这篇文章中的 content 部分，没有 wordsMapX 中的单词，而在 title 部分有 wordsMapX 中的单词。此时该篇文章应被剔除
-        {
-            remove(sortedIDs.begin(), sortedIDs.end(), ID);
-            continue;
-        }
+    size_t first_to_end = content.size() - first_pos;                                                   // 从 content[first_pos] 到字符串末尾所占字节数
+    size_t right_pos = first_pos + howManyBytesWithNCharacter(content.data() + first_pos, first_to_end, STEP); // 从 content[first_pos] 到其后 STEP 个字符所占字节数（first_to_end 为上限）
+    size_t left_pos = backwardPosWithNCharacter(content, first_pos, STEP);                            // 从 content[first_pos] 往前 STEP 个字符的起始字节
 
-        size_t first_to_end = content.substr(first_pos).size();                                             // 从 content[first_pos] 到字符串末尾所占字节数
-        size_t right_pos = first_pos + howManyBytesWithNCharacter(&content[first_pos], first_to_end, STEP); // 从 content[first_pos] 到其后 STEP 个字符所占字节数（first_to_end 为上限）
-
-        vector<size_t> ppc = getPosPerCharactor(content, first_pos);       // 从字符串前 first_pos 字节中所有字符的起始字节
-        size_t left_pos = ppc.size() >= STEP ? ppc[ppc.size() - STEP] : 0; 
-        // size_t left_pos = ppc.size() >= STEP ? ppc[ppc.size() - STEP] : ppc[0]; // ppc[0] 一定是 0
-
-        string summary = "";
-        if (left_pos != 0) // content[left_pos] 前还有字符
-            summary += " ... ji";
-        summary += content.substr(left_pos, right_pos - left_pos);
-        if (right_pos < content.size()) // content[right_pos] 后还有字符
-            summary += " ... ";
-        // summary += content.substr(first_pos);
-        _pageList[ID].setPageSummary(summary);
-    }
+    return {left_pos, right_pos};
 }
 
 /**
- *  返回搜索失败后的 json 格式字符串
+ *  返回搜索失败后的序列化结果
  */
-string WebPageSearcher::serializeForNoting()
+string WebPageSearcher::serializeForNoting(bool partial, WireFormat format)
 {
-    Json root;
-    root["msgID"] = 404;
-    root["msg"] = json("未能找到相关文章");
-    // root["msg"] = "未能找到相关文章"; // 一样的效果
+    string response;
+    if (format == WireFormat::Binary)
+    {
+        BinaryWriter writer(response);
+        writer.putU16(404).putU8(partial).putString("未能找到相关文章");
+        return response;
+    }
 
-    return root.dump(4);
+    JsonWriter writer(response, _prettyJson);
+    writer.beginObject()
+        .key("msgID").value(404)
+        .key("partial").value(partial) // 为 true 表示超时，并非确实没有相关文章
+        .key("msg").value("未能找到相关文章")
+        .endObject();
+    return response;
 }
 
 /**
- *  返回使用 json 序列化后的所有网页信息
+ *  返回使用 json 序列化后的一页网页信息
+ *
+ *  1. cursor 为该排序结果的游标，客户翻页时带回；cursorRange 不为 nullptr 时输出
+ *     游标字段的值在响应中的范围（生成结果缓存记录时去掉）
+ *  2. total 为排序结果中的网页总数
+ *  3. msg 中只包含第 [offset, offset + limit) 篇网页
+ *  4. partial 为 true 表示检索超时，结果可能不完整
+ *  5. 字段直接写入本线程复用的缓冲区，title、url、摘要都从网页库的视图转义写入，
+ *     每篇网页不分配内存
  */
-string WebPageSearcher::serialize(const vector<PageID> &sortedIDs)
+string WebPageSearcher::serialize(CursorCache::Cursor cursor, const RankedList &rankedList, size_t offset, size_t limit,
+                                  WireFormat format, pair<size_t, size_t> *cursorRange)
 {
-    const PageID N = stol(Configuration::getInstance()->getConfigMap()["maxpagenum"]);
+    if (format == WireFormat::Binary)
+        return serializeBinary(cursor, rankedList, offset, limit, cursorRange);
+
+    thread_local string buffer; // 每个工作线程一块，跨请求复用
+    buffer.clear();
+
+    const vector<PageID> &sortedIDs = rankedList.IDs;
+
+    JsonWriter writer(buffer, _prettyJson);
+    writer.beginObject()
+        .key("msgID").value(200)
+        .key("cursor"); // 键之后直接写值，此处即为值的起点
+    size_t cursorPos = buffer.size();
+    writer.value(cursor);
+    if (cursorRange)
+        *cursorRange = {cursorPos, buffer.size()};
+    writer.key("total").value(sortedIDs.size())
+        .key("offset").value(offset)
+        .key("partial").value(rankedList.partial)
+        .key("msg").beginArray();
+    for (size_t idx = offset; idx < sortedIDs.size() && idx - offset < limit; ++idx)
+    {
+        DocView page = _docStore.getDoc(sortedIDs[idx]);
+        uint32_t anchor = getAnchor(sortedIDs[idx], rankedList.wordsMap);
+        pair<size_t, size_t> range = getSummaryRange(page, rankedList.wordsMap, anchor);
+
+        writer.beginObject()
+            .key("title").value(page.title)
+            .key("url").value(page.url)
+            .key("summary").beginString();
+        if (range.first != 0) // content[left_pos] 前还有字符
+            writer.appendString(" ... ");
+        writer.appendString(page.content.substr(range.first, range.second - range.first));
+        if (range.second < page.content.size()) // content[right_pos] 后还有字符
+            writer.appendString(" ... ");
+        writer.endString().endObject();
+    }
+    writer.endArray().endObject();
 
-    Json root;
-    root["msgID"] = 200;
+    return buffer;
+}
 
-    Json msg;
-    PageID cnt = 0;
-    for (auto &ID : sortedIDs)
+/**
+ *  同 serialize，按二进制协议写入（字段顺序与 json 相同，字符串不转义）
+ */
+string WebPageSearcher::serializeBinary(CursorCache::Cursor cursor, const RankedList &rankedList, size_t offset, size_t limit,
+                                        pair<size_t, size_t> *cursorRange)
+{
+    thread_local string buffer;
+    buffer.clear();
+
+    const vector<PageID> &sortedIDs = rankedList.IDs;
+    size_t count = offset < sortedIDs.size() ? std::min(limit, sortedIDs.size() - offset) : 0;
+
+    BinaryWriter writer(buffer);
+    writer.putU16(200)
+        .putU64(cursor);
+    if (cursorRange)
+        *cursorRange = {2, 10}; // u16 msgID 之后的 u64
+    writer.putU32(sortedIDs.size())
+        .putU32(offset)
+        .putU8(rankedList.partial)
+        .putU32(count);
+    for (size_t idx = offset; idx < offset + count; ++idx)
     {
-        if (++cnt > N) // 第 N+1 次进入循环体则退出（保证只发送前 N 篇网页）
-            break;
-        WebPage &page = _pageList[ID];
-
-        Json file;
-        file["title"] = page.getTitle();
-        file["url"] = page.getUrl();
-        file["summary"] = page.getSummary();
-        msg.push_back(file);
+        DocView page = _docStore.getDoc(sortedIDs[idx]);
+        uint32_t anchor = getAnchor(sortedIDs[idx], rankedList.wordsMap);
+        pair<size_t, size_t> range = getSummaryRange(page, rankedList.wordsMap, anchor);
+
+        writer.putString(page.title).putString(page.url).beginString();
+        if (range.first != 0)
+            writer.appendString(" ... ");
+        writer.appendString(page.content.substr(range.first, range.second - range.first));
+        if (range.second < page.content.size())
+            writer.appendString(" ... ");
+        writer.endString();
     }
-    root["msg"] = msg;
 
-    return root.dump(4);
+    return buffer;
 }
 
 }; // namespace wdcpp
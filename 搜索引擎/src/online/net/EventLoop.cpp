@@ -14,7 +14,7 @@ EventLoop::EventLoop(Acceptor &acceptor)
     : _epFd(createEpoll()),
       _eventFd(createEvent()),
       _acceptor(acceptor),
-      _isLooping(false),
+      _isLooping(true), // 只由 unloop 置为 false，loop 不再重置，先于 loop 到来的 unloop 不会丢失
       _eventList(INIT_EPOLLNUM) // 为 _eventList 初始化（即插入 INIT_EPOLLNUM 个空的 epoll_event）
 {
     addEpollFd(_acceptor.fd()); // 将 _listenSock._fd 加入监听集合 _epFd
@@ -28,12 +28,10 @@ EventLoop::~EventLoop()
 }
 
 /**
- *  开启 loop
+ *  开启 loop（已调用过 unloop 时立即返回）
  */
 void EventLoop::loop()
 {
-    _isLooping = true;
-
     while (_isLooping)
         waitEpoll(); // loop 的执行体
 }
@@ -43,12 +41,14 @@ void EventLoop::loop()
  *
  *  1. 让运行在 loop 中的线程退出 while 循环
  *  2. 执行 unloop 的线程和 执行 loop 的线程不是同一个，否则没有效果
- *  3. 执行 unloop 后，服务器只是暂时停止 epoll 监听，_listenSock._fd 和 _epFd 和 peerFd 都没有 close
- *     此时只要再将 _isLooping 设为 true，服务器可以照常运行
+ *  3. 执行 unloop 后，服务器停止 epoll 监听，_listenSock._fd 和 _epFd 和 peerFd 都没有 close
+ *  4. 写 _eventFd 唤醒 epoll_wait，使 loop 立即退出而不必等到超时
+ *  5. 退出请求是粘滞的：在 loop 开始之前调用 unloop，loop 也会立即返回（如启动期间收到 SIGINT）
  */
 void EventLoop::unloop()
 {
     _isLooping = false;
+    writeCounter();
 }
 
 /**
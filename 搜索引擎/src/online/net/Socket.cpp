@@ -44,6 +44,12 @@ void Socket::shutDownWrite()
     ERROR_CHECK(ret, -1, "shutdown");
 }
 
+void Socket::shutDown()
+{
+    int ret = ::shutdown(_fd, SHUT_RDWR); // 读写两个方向都关闭，RCV 中未读的数据不再处理
+    ERROR_CHECK(ret, -1, "shutdown");
+}
+
 void Socket::setNonBlock()
 {
     int flags = ::fcntl(_fd, F_GETFL, 0);
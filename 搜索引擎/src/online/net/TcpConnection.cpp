@@ -2,6 +2,7 @@
 #include "EventLoop.h"
 
 #include <sys/socket.h>
+#include <string.h>
 #include <sstream>
 #include <ErrorCheck>
 #include <iostream>
@@ -18,6 +19,7 @@ TcpConnection::TcpConnection(int fd, EventLoop *loopPtr)
       _localAddr(getLocalAddr()),
       _peerAddr(getPeerAddr()),
       _isShutDownWrite(false),
+      _isShutDown(false),
       _loopPtr(loopPtr)
 {
 }
@@ -44,6 +46,19 @@ void TcpConnection::send(const string &msg)
     // ret > msg.size() 出错
 }
 
+/**
+ *  发送一帧二进制协议数据（帧头中的 length 按 body 填写）
+ */
+void TcpConnection::sendFrame(const FrameHeader &header, const string &body)
+{
+    FrameHeader frameHeader = header;
+    frameHeader.length = body.size();
+    char buf[WIRE_HEADER_SIZE];
+    encodeFrameHeader(frameHeader, buf);
+    _sockIO.writen(buf, sizeof(buf));          // 发送帧头
+    _sockIO.writen(body.data(), body.size()); // 发送报文体
+}
+
 /**
  *  获取数据（按小火车协议）
  */
@@ -70,6 +85,61 @@ string TcpConnection::recv()
     return buf; // 注：收到的 json 字符串末尾不含 \n，因此无需去掉最后一个字符
 }
 
+/**
+ *  获取一条消息（二进制协议或小火车协议）
+ *
+ *  1. 先读 4 字节：等于 WIRE_MAGIC 则再读出帧头的其余 12 字节
+ *  2. 否则这 4 字节是小火车车头（size_t）的前 4 字节，再读出其余部分
+ *     （车头按本机字节序逐字节拼回；长度恰好等于 WIRE_MAGIC 的 json 帧超过上限，不会出现）
+ *  3. 连接断开、读取不完整、报文体超过上限或版本号为 0 时 valid 为 false，
+ *     此时报文体未被读出，调用方须关闭连接而不是继续读下一帧
+ */
+Message TcpConnection::recvMessage()
+{
+    Message message;
+    char head[WIRE_HEADER_SIZE] = {0};
+    if (_sockIO.readn(head, sizeof(uint32_t)) != sizeof(uint32_t))
+        return message;
+
+    size_t length = 0;
+    if (loadU32(head) == WIRE_MAGIC)
+    {
+        if (_sockIO.readn(head + sizeof(uint32_t), WIRE_HEADER_SIZE - sizeof(uint32_t)) != WIRE_HEADER_SIZE - sizeof(uint32_t))
+            return message;
+        message.format = WireFormat::Binary;
+        message.header = decodeFrameHeader(head);
+        length = message.header.length;
+        if (message.header.version == 0)
+        {
+            ERROR_PRINT("recv: bad protocol version\n");
+            return message;
+        }
+    }
+    else
+    {
+        ::memcpy(&length, head, sizeof(uint32_t)); // 接收车头
+        if (_sockIO.readn((char *)&length + sizeof(uint32_t), sizeof(size_t) - sizeof(uint32_t)) != sizeof(size_t) - sizeof(uint32_t))
+            return message;
+    }
+
+    if (length > WIRE_MAX_BODY)
+    {
+        ERROR_PRINT("recv: frame too large: %lu\n", length);
+        return message;
+    }
+    message.body.resize(length);
+    if (length > 0 && _sockIO.readn(&message.body[0], length) != length) // 接收报文体
+        return message;
+
+#ifdef __DEBUG__
+    printf("\t(File:%s, Func:%s(), Line:%d)\n", __FILE__, __FUNCTION__, __LINE__);
+    cout << "length = " << length << endl;
+#endif
+
+    message.valid = true;
+    return message;
+}
+
 /**
  *  获取一行数据
  */
@@ -112,7 +182,22 @@ bool TcpConnection::isClosed() const
         ret = ::recv(_clientSock.fd(), tmp_buf, sizeof(tmp_buf), MSG_PEEK); // 扫描 _clientSock._fd 的 RCV 但不取出数据
     } while (ret == -1 && errno == EINTR);                                  // 收到中断信号直接忽略
 
-    return ret == 0; // 返回 0 表示连接已断开
+    return _isShutDown || ret == 0; // 返回 0 表示连接已断开
+}
+
+/**
+ *  服务端主动关闭连接
+ *
+ *  1. 只能在 loop 线程中调用（如 onMessageCb 中）
+ *  2. 关闭套接字的读写两端，epoll 随即报告读就绪，
+ *     下一轮 handleOldConnection 中 isClosed 为真，照常执行 onCloseCb 并移出 _connMap
+ */
+void TcpConnection::shutdown()
+{
+    if (_isShutDown)
+        return;
+    _isShutDown = true;
+    _clientSock.shutDown();
 }
 
 InetAddress TcpConnection::getLocalAddr()
@@ -190,4 +275,12 @@ void TcpConnection::notifyLoop(const string &msg)
     // 向内核计数器中写值
     _loopPtr->writeCounter();
 }
+/**
+ *  同上，回复的是一帧二进制协议数据
+ */
+void TcpConnection::notifyLoop(const FrameHeader &header, const string &body)
+{
+    _loopPtr->setPendingCallBack(std::bind(&TcpConnection::sendFrame, this, header, body));
+    _loopPtr->writeCounter();
+}
 };
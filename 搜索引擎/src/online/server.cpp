@@ -21,14 +21,14 @@ void test1()
 void test2()
 {
     auto p = CacheManager::getInstance();
-    auto cacheGroup = p->getCacheGroup(0);
+    auto &cacheGroup = p->getCacheGroup(0);
     auto res = cacheGroup.getRecord("hello");
-    cacheGroup.insertRecord("hello", "hello");
-    cacheGroup.insertRecord("xixi", "xixi");
-    cacheGroup.insertRecord("haha", "haha");
-    cacheGroup.insertRecord("loulou", "loulou");
+    cacheGroup.insertRecord("hello", std::make_shared<const string>("hello"));
+    cacheGroup.insertRecord("xixi", std::make_shared<const string>("xixi"));
+    cacheGroup.insertRecord("haha", std::make_shared<const string>("haha"));
+    cacheGroup.insertRecord("loulou", std::make_shared<const string>("loulou"));
     auto res1 = cacheGroup.getRecord("xixi");
-    cout << res1 << endl;
+    cout << *res1 << endl;
 }
 
 int main()
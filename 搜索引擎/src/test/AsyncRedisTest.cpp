@@ -0,0 +1,288 @@
+// AsyncRedis 的测试：进程内起一个只支持 GET/SETEX 的简易 RESP 服务代替 redis-server
+#include "AsyncRedis.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace wdcpp;
+
+static atomic<int> failures(0);
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            cout << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond << endl; \
+            ++failures;                                                      \
+        }                                                                    \
+    } while (0)
+
+/**
+ *  简易 redis：每次读到数据后先睡 delayMs 毫秒再处理，用来验证 get 不等待网络往返
+ */
+class FakeRedis
+{
+public:
+    explicit FakeRedis(int delayMs)
+        : _delayMs(delayMs), _batches(0)
+    {
+        _listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0; // 由内核分配端口
+        ::bind(_listenFd, (struct sockaddr *)&addr, sizeof(addr));
+        ::listen(_listenFd, 16);
+        socklen_t len = sizeof(addr);
+        ::getsockname(_listenFd, (struct sockaddr *)&addr, &len);
+        _port = ntohs(addr.sin_port);
+        _acceptor = thread(&FakeRedis::acceptLoop, this);
+    }
+
+    ~FakeRedis()
+    {
+        ::shutdown(_listenFd, SHUT_RDWR); // 唤醒 accept
+        _acceptor.join();
+        for (int fd : _peerFds)
+            ::shutdown(fd, SHUT_RDWR);
+        for (auto &worker : _workers)
+            worker.join();
+        ::close(_listenFd);
+    }
+
+    string uri() const
+    {
+        return "tcp://127.0.0.1:" + to_string(_port);
+    }
+
+    int batches() const
+    {
+        return _batches.load();
+    }
+
+private:
+    void acceptLoop()
+    {
+        int fd;
+        while ((fd = ::accept(_listenFd, nullptr, nullptr)) >= 0)
+        {
+            _peerFds.push_back(fd);
+            _workers.emplace_back(&FakeRedis::serve, this, fd);
+        }
+    }
+
+    void serve(int fd)
+    {
+        string buf;
+        char tmp[4096];
+        ssize_t ret;
+        while ((ret = ::read(fd, tmp, sizeof(tmp))) > 0)
+        {
+            buf.append(tmp, ret);
+            this_thread::sleep_for(chrono::milliseconds(_delayMs));
+            ++_batches;
+
+            string out;
+            vector<string> command;
+            size_t used;
+            while ((used = parse(buf, command)) > 0)
+            {
+                buf.erase(0, used);
+                out += execute(command);
+            }
+            if (!out.empty() && ::write(fd, out.data(), out.size()) < 0)
+                break;
+        }
+        ::close(fd);
+    }
+
+    /**
+     *  从 buf 开头解析一条命令（*N\r\n 后跟 N 个 $len\r\n...\r\n），不完整时返回 0
+     */
+    static size_t parse(const string &buf, vector<string> &command)
+    {
+        command.clear();
+        size_t pos = 0;
+        auto readLine = [&](string &line) {
+            size_t end = buf.find("\r\n", pos);
+            if (end == string::npos)
+                return false;
+            line = buf.substr(pos, end - pos);
+            pos = end + 2;
+            return true;
+        };
+
+        string line;
+        if (!readLine(line) || line.empty() || line[0] != '*')
+            return 0;
+        long count = stol(line.substr(1));
+        for (long idx = 0; idx < count; ++idx)
+        {
+            if (!readLine(line) || line.empty() || line[0] != '$')
+                return 0;
+            size_t length = stoul(line.substr(1));
+            if (buf.size() < pos + length + 2)
+                return 0;
+            command.push_back(buf.substr(pos, length));
+            pos += length + 2;
+        }
+        return pos;
+    }
+
+    string execute(const vector<string> &command)
+    {
+        lock_guard<mutex> autolock(_mutex);
+        if (command.size() == 2 && command[0] == "GET")
+        {
+            auto it = _store.find(command[1]);
+            if (it == _store.end())
+                return "$-1\r\n";
+            return "$" + to_string(it->second.size()) + "\r\n" + it->second + "\r\n";
+        }
+        if (command.size() == 4 && command[0] == "SETEX")
+        {
+            _store[command[1]] = command[3];
+            return "+OK\r\n";
+        }
+        return "-ERR unsupported\r\n";
+    }
+
+private:
+    int _delayMs;
+    int _listenFd;
+    unsigned short _port;
+    atomic<int> _batches;
+    thread _acceptor;
+    vector<int> _peerFds;
+    vector<thread> _workers;
+    map<string, string> _store;
+    mutex _mutex;
+};
+
+/**
+ *  等待 counter 达到 expected，超时返回 false
+ */
+static bool waitFor(const atomic<int> &counter, int expected, int timeoutMs = 5000)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    while (counter.load() < expected)
+    {
+        if (chrono::steady_clock::now() > deadline)
+            return false;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// setex 之后 get 得到写入的值，未写入的 key 未命中
+void testGetSet()
+{
+    FakeRedis server(0);
+    AsyncRedis redis(server.uri());
+    redis.start();
+
+    redis.setex("hello", 60, "world");
+    atomic<int> done(0);
+    sw::redis::OptionalString hit, miss;
+    // 同一队列中 SETEX 先于后面的 GET 入队，但同一批次中 GET 先发出，因此先等 SETEX 落地
+    CHECK(redis.get("hello", [&](const sw::redis::OptionalString &) { ++done; }));
+    CHECK(waitFor(done, 1));
+    CHECK(redis.get("hello", [&](const sw::redis::OptionalString &result) { hit = result; ++done; }));
+    CHECK(redis.get("nothing", [&](const sw::redis::OptionalString &result) { miss = result; ++done; }));
+    CHECK(waitFor(done, 3));
+    CHECK(hit && *hit == "world");
+    CHECK(!miss);
+
+    redis.stop();
+}
+
+// get 放入队列即返回，不等待网络往返；多个线程并发的 GET 合并为少数批次
+void testNonBlocking()
+{
+    const int DELAY_MS = 200;
+    const int THREAD_NUM = 8;
+    FakeRedis server(DELAY_MS);
+    AsyncRedis redis(server.uri());
+    redis.start();
+
+    atomic<int> done(0);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int idx = 0; idx < THREAD_NUM; ++idx)
+        threads.emplace_back([&, idx] {
+            CHECK(redis.get("key" + to_string(idx), [&](const sw::redis::OptionalString &) { ++done; }));
+        });
+    for (auto &worker : threads)
+        worker.join();
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    CHECK(elapsed < DELAY_MS / 2); // 所有 get 都没有等待 redis
+
+    CHECK(waitFor(done, THREAD_NUM));
+    CHECK(server.batches() < THREAD_NUM); // 至少有一部分 GET 共用了一次往返
+
+    redis.stop();
+}
+
+// stop 时已入队的 GET 仍会收到回调，stop 之后 get 返回 false 且不调用回调
+void testStop()
+{
+    FakeRedis server(50);
+    AsyncRedis redis(server.uri());
+    redis.start();
+
+    atomic<int> done(0);
+    for (int idx = 0; idx < 4; ++idx)
+        CHECK(redis.get("key", [&](const sw::redis::OptionalString &) { ++done; }));
+    redis.stop();
+    CHECK(done.load() == 4);
+
+    CHECK(!redis.get("key", [&](const sw::redis::OptionalString &) { ++done; }));
+    CHECK(done.load() == 4);
+}
+
+// redis 不可达时按未命中处理，回调照常调用
+void testUnreachable()
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0); // 占用一个端口后关闭，保证无人监听
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, (struct sockaddr *)&addr, &len);
+    ::close(fd);
+
+    AsyncRedis redis("tcp://127.0.0.1:" + to_string(ntohs(addr.sin_port)));
+    redis.start();
+
+    atomic<int> done(0);
+    sw::redis::OptionalString result("unset");
+    CHECK(redis.get("key", [&](const sw::redis::OptionalString &reply) { result = reply; ++done; }));
+    CHECK(waitFor(done, 1));
+    CHECK(!result);
+
+    redis.stop();
+}
+
+int main()
+{
+    testGetSet();
+    testNonBlocking();
+    testStop();
+    testUnreachable();
+
+    if (failures == 0)
+        cout << "AsyncRedisTest: all passed" << endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+// CacheManager group 模式同步的测试（多个工作线程并发读写，定时线程同步）
+//
+// 与服务器一样从 ../conf/myconf.conf 读配置，要求 cachemode 为 group、cachebytes 为 0，
+// 且 recordnum 不小于 workernum * (4 * synclognum + 320)（保证测试中的记录不会被淘汰）
+#include "CacheManager.h"
+#include "Configuration.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+using namespace wdcpp;
+
+static atomic<int> failures(0);
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            cout << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond << endl; \
+            ++failures;                                                      \
+        }                                                                    \
+    } while (0)
+
+static size_t workerNum;
+static size_t logCapacity;
+
+/**
+ *  以工作线程 0 ~ workerNum-1 的身份（__thread_id）并发执行 func(id)
+ */
+template <typename Func>
+static void runWorkers(Func func)
+{
+    vector<unique_ptr<Thread>> threads;
+    for (size_t id = 0; id < workerNum; ++id)
+        threads.emplace_back(new Thread(id, [func, id] { func(id); }));
+    for (auto &thread : threads)
+        thread->create();
+    for (auto &thread : threads)
+        thread->join();
+}
+
+static string keyOf(const string &phase, size_t id, size_t idx)
+{
+    return phase + ":" + to_string(id) + ":" + to_string(idx);
+}
+
+/**
+ *  每个工作线程都能看到所有线程写入的 count 条记录（值等于键）
+ */
+static void checkAllVisible(const string &phase, size_t count)
+{
+    atomic<size_t> missing(0);
+    runWorkers([&](size_t) {
+        CacheManager *pManager = CacheManager::getInstance();
+        for (size_t owner = 0; owner < workerNum; ++owner)
+        {
+            for (size_t idx = 0; idx < count; ++idx)
+            {
+                string key = keyOf(phase, owner, idx);
+                LRUCache::Value value = pManager->getRecord(key);
+                if (!value || *value != key)
+                    ++missing;
+            }
+        }
+    });
+    if (missing.load() != 0)
+        cout << phase << ": " << missing.load() << " records missing" << endl;
+    CHECK(missing.load() == 0);
+}
+
+// 日志不满时，一次同步后所有线程都能看到彼此的新记录
+void testDelta()
+{
+    size_t count = logCapacity / 2;
+    runWorkers([&](size_t id) {
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            string key = keyOf("delta", id, idx);
+            CacheManager::getInstance()->insertRecord(key, make_shared<const string>(key));
+        }
+    });
+    CacheManager::getInstance()->sync();
+    checkAllVisible("delta", count);
+}
+
+// 两次同步之间写入超过 synclognum 条记录：丢失被计数，并以全量副本补上
+void testDropped()
+{
+    CacheManager *pManager = CacheManager::getInstance();
+    uint64_t dropped = pManager->getDroppedRecords();
+    uint64_t copies = pManager->getFullCopies();
+
+    size_t count = logCapacity * 2;
+    runWorkers([&](size_t id) {
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            string key = keyOf("dropped", id, idx);
+            pManager->insertRecord(key, make_shared<const string>(key));
+        }
+    });
+    pManager->sync();                                            // 发现丢失，要求全量副本
+    runWorkers([&](size_t) { pManager->getRecord("touch"); }); // 安全点：提交副本
+    pManager->sync();                                            // 发布副本
+
+    CHECK(pManager->getDroppedRecords() > dropped);
+    CHECK(pManager->getFullCopies() >= copies + workerNum);
+    checkAllVisible("dropped", count);
+}
+
+// 工作线程 0 在其他线程写入并同步多于 SYNC_HISTORY 次期间不访问缓存，之后由全量复制追上
+void testBehind()
+{
+    CacheManager *pManager = CacheManager::getInstance();
+    uint64_t copies = pManager->getFullCopies();
+
+    const size_t ROUNDS = 40; // 大于 SYNC_HISTORY
+    const size_t PER_ROUND = 8;
+    for (size_t round = 0; round < ROUNDS; ++round)
+    {
+        runWorkers([&](size_t id) {
+            if (id == 0)
+                return;
+            for (size_t idx = round * PER_ROUND; idx < (round + 1) * PER_ROUND; ++idx)
+            {
+                string key = keyOf("behind", id, idx);
+                pManager->insertRecord(key, make_shared<const string>(key));
+            }
+        });
+        pManager->sync();
+    }
+
+    atomic<size_t> missing(0);
+    runWorkers([&](size_t id) {
+        if (id != 0)
+            return;
+        for (size_t owner = 1; owner < workerNum; ++owner)
+        {
+            for (size_t idx = 0; idx < ROUNDS * PER_ROUND; ++idx)
+            {
+                string key = keyOf("behind", owner, idx);
+                LRUCache::Value value = pManager->getRecord(key);
+                if (!value || *value != key)
+                    ++missing;
+            }
+        }
+    });
+    CHECK(missing.load() == 0);
+    CHECK(workerNum < 2 || pManager->getFullCopies() > copies);
+}
+
+// 工作线程并发读写，同时定时线程不停同步；停下后再同步两次，所有线程应看到全部记录
+void testConcurrent()
+{
+    CacheManager *pManager = CacheManager::getInstance();
+    const size_t COUNT = logCapacity;
+    atomic<bool> isRunning(true);
+    Thread syncer([&] {
+        while (isRunning.load())
+            pManager->sync();
+    });
+    syncer.create();
+
+    runWorkers([&](size_t id) {
+        for (size_t idx = 0; idx < COUNT; ++idx)
+        {
+            string key = keyOf("concurrent", id, idx);
+            pManager->insertRecord(key, make_shared<const string>(key));
+            pManager->getRecord(keyOf("concurrent", (id + 1) % workerNum, idx)); // 读其他线程的记录，命中与否都可以
+        }
+    });
+    isRunning = false;
+    syncer.join();
+
+    pManager->sync();
+    runWorkers([&](size_t) { pManager->getRecord("touch"); }); // 提交可能被要求的全量副本
+    pManager->sync();
+    checkAllVisible("concurrent", COUNT);
+}
+
+int main()
+{
+    Configuration *pConf = Configuration::getInstance();
+    CacheManager *pManager = CacheManager::getInstance();
+    workerNum = pConf->getNumber("workernum", 0);
+    logCapacity = pConf->getNumber("synclognum", 4096);
+    size_t maxRecord = pConf->getNumber("recordnum", 0);
+    if (pManager->getMode() != CacheMode::Group || pConf->getNumber("cachebytes", 0) != 0 ||
+        workerNum == 0 || maxRecord < workerNum * (4 * logCapacity + 320))
+    {
+        cout << "CacheSyncTest: needs cachemode group, cachebytes 0 and recordnum >= workernum * (4 * synclognum + 320)" << endl;
+        return 1;
+    }
+
+    testDelta();
+    testDropped();
+    testBehind();
+    testConcurrent();
+
+    if (failures == 0)
+        cout << "CacheSyncTest: all passed" << endl;
+    return failures == 0 ? 0 : 1;
+}